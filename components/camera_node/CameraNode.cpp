@@ -3,7 +3,6 @@
 //
 // TODO:
 //  - Add board-specific pin mappings for different dev kits.
-//  - Expose runtime configuration (frame size, pixel format, etc.).
 //  - Add error codes / status enum instead of bool return from init().
 
 #include "CameraNode.hpp"
@@ -12,7 +11,7 @@
 
 static const char* TAG = "CameraNode";
 
-bool CameraNode::init()
+bool CameraNode::init(const Config& capture)
 {
     camera_config_t config = {};
 
@@ -34,12 +33,12 @@ bool CameraNode::init()
     config.pin_href     = 42;
     config.pin_pclk     = 8;
 
-    config.xclk_freq_hz = 20'000'000;
+    config.xclk_freq_hz = capture.xclk_freq_hz;
     config.ledc_timer   = LEDC_TIMER_0;
     config.ledc_channel = LEDC_CHANNEL_0;
 
-    config.pixel_format = PIXFORMAT_JPEG;     // good for streaming
-    config.frame_size   = FRAMESIZE_QVGA;     // 320x240 to start
+    config.pixel_format = capture.pixel_format;
+    config.frame_size   = capture.frame_size;
     config.jpeg_quality = 12;
     config.fb_count     = 1;
 
@@ -12,11 +12,24 @@
 /// so it can be reused in different applications and pipelines.
 class CameraNode {
 public:
+    /// @brief Capture configuration passed to the esp32-camera driver.
+    struct Config {
+        framesize_t frame_size = FRAMESIZE_QVGA;        ///< Base frame size (framebuffers are sized for it)
+        int xclk_freq_hz = 20'000'000;                   ///< Sensor master clock
+        pixformat_t pixel_format = PIXFORMAT_JPEG;      ///< Output format (CvPipeline / SensorConfig need RGB565)
+    };
+
     CameraNode() = default;
     
     /// @brief Initialize the camera hardware and driver.
     /// @return true on success, false if initialization fails.
-    bool init();
+    bool init(const Config& config);
+
+    /// @brief Initialize with the default Config.
+    bool init() { return init(Config()); }
+
+    /// @brief Sensor handle for windowing / scaling (valid after init()).
+    sensor_t* sensor() const { return esp_camera_sensor_get(); }
     
     /// @brief Capture a frame from the camera.
     /// @return Pointer to frame buffer, or nullptr on failure.
@@ -3,7 +3,7 @@
  * @brief Implementation of the CCM Code Embedded Vision Pipeline.
  *
  * Handles buffer management (PSRAM/DRAM) and executes the configured
- * CV stages sequentially.
+ * CV stages, either sequentially over the whole frame or fused per strip.
  *
  * @author CCM Code (Christie Cahill Meyer)
  * @date 2025
@@ -12,27 +12,351 @@
 
 #include "CvPipeline.hpp"
 #include <esp_log.h>
-#include <esp_heap_caps.h>
+#include <esp_timer.h>
 #include <cstring>
 #include <algorithm>
-#include <queue>
+#include <cmath>
 
 static const char* TAG = "CvPipeline";
 
+// Flood-fill pixel markers (the threshold stage produces 0/255 only)
+static constexpr uint8_t kForeground = 255;
+static constexpr uint8_t kPending = 1;   // Foreground seen while the queue was full
+static constexpr uint8_t kLabelled = 128; // Visited foreground (only when perimeters are measured)
+
+/// @brief RGB565 (little-endian byte pair) to 8-bit luma.
+static inline uint8_t rgb565ToLuma(const uint8_t* px) {
+    uint16_t pixel = (px[1] << 8) | px[0];
+
+    // Extract RGB565 components
+    uint8_t r = (pixel >> 11) & 0x1F;
+    uint8_t g = (pixel >> 5) & 0x3F;
+    uint8_t b = pixel & 0x1F;
+
+    // Approximate Luminance:
+    // Scaled to 8-bit range approx (R*2 + G*4 + B) / 8
+    // Higher precision: 0.299R + 0.587G + 0.114B
+
+    // We expand 5/6-bit to 8-bit first for better accuracy
+    uint16_t r8 = (r * 527 + 23) >> 6;
+    uint16_t g8 = (g * 259 + 33) >> 6;
+    uint16_t b8 = (b * 527 + 23) >> 6;
+
+    return (uint8_t)((r8 * 77 + g8 * 150 + b8 * 29) >> 8);
+}
+
+/// @brief Pyramid buffers are sized whenever a factor is set, even while
+/// blur or morphology keep the mode off: a QualityGovernor level that drops
+/// those stages must still fit the base config's arena.
+/// validateConfig() rejects the stages pyramid mode cannot run at all.
+static bool pyramidReserved(const PipelineConfig& config) {
+    return config.pyramid_factor > 1;
+}
+
+/// @brief Pyramid mode needs the plain gray -> threshold -> label path.
+static bool pyramidActive(const PipelineConfig& config) {
+    return pyramidReserved(config) && config.blur_radius == 0 && config.morph_op == MorphOp::None;
+}
+
+/// @brief Source window the ROI selects on a @p fw x @p fh frame (clamped as in applyROI()).
+static void sourceWindow(const PipelineConfig& config, size_t fw, size_t fh,
+                         size_t& rx, size_t& ry, size_t& rw, size_t& rh) {
+    rx = 0; ry = 0; rw = fw; rh = fh;
+    if (!config.enable_roi || fw == 0 || fh == 0) return;
+    size_t cx = std::min((size_t)config.roi_x, fw - 1);
+    size_t cy = std::min((size_t)config.roi_y, fh - 1);
+    size_t cw = std::min((size_t)config.roi_w, fw - cx);
+    size_t ch = std::min((size_t)config.roi_h, fh - cy);
+    if (cw > 0 && ch > 0) {
+        rx = cx; ry = cy; rw = cw; rh = ch;
+    }
+}
+
+/// @brief Reject stage combinations process() cannot honour, instead of skipping stages silently.
+static bool validateConfig(const PipelineConfig& config) {
+    if (config.pyramid_factor != 0 && config.pyramid_factor != 4 && config.pyramid_factor != 8) {
+        ESP_LOGE(TAG, "pyramid_factor %u not supported (0, 4 or 8)", config.pyramid_factor);
+        return false;
+    }
+    // Pyramid mode replaces the gray -> threshold -> label path; blur and
+    // morphology only hold it off (full-resolution path) so the governor can drop them
+    if (config.pyramid_factor != 0 &&
+        (!config.enable_threshold || !config.enable_blob_detection || config.enable_color ||
+         config.enable_edges || config.roi_count > 0 || config.strip_rows > 0)) {
+        ESP_LOGE(TAG, "pyramid_factor needs threshold + blob detection and supports neither colour, edges, "
+                      "multi-ROI nor strips");
+        return false;
+    }
+    if (config.enable_edges && (config.blur_radius > 0 || config.strip_rows > 0)) {
+        ESP_LOGE(TAG, "enable_edges cannot be combined with blur_radius or strip_rows");
+        return false;
+    }
+    // Colour mode labels the class bitmask straight from the LUT pass
+    if (config.enable_color &&
+        (config.blur_radius > 0 || config.enable_threshold || config.morph_op != MorphOp::None ||
+         config.enable_edges || config.strip_rows > 0)) {
+        ESP_LOGE(TAG, "enable_color supports neither blur, threshold, morphology, edges nor strips");
+        return false;
+    }
+    // Multi-ROI runs its own fused gray + threshold pass and plain labeling per zone
+    if (config.roi_count > 0 &&
+        (config.blur_radius > 0 || config.morph_op != MorphOp::None || config.enable_color ||
+         config.enable_edges || config.strip_rows > 0 || config.blob_moments || config.blob_perimeter)) {
+        ESP_LOGE(TAG, "roi_count > 0 supports neither blur, morphology, colour, edges, strips nor shape descriptors");
+        return false;
+    }
+    if (config.roi_count > kMaxRois) {
+        ESP_LOGE(TAG, "roi_count %u exceeds %u", config.roi_count, kMaxRois);
+        return false;
+    }
+    if (config.roi_count > 0 && config.enable_roi) {
+        ESP_LOGE(TAG, "enable_roi and roi_count > 0 are exclusive");
+        return false;
+    }
+    // Zone buffers are sized from the zone itself: it must fit the largest frame
+    const size_t f = std::max<size_t>(config.downsample_factor, 1);
+    for (size_t i = 0; i < config.roi_count; i++) {
+        const RoiConfig& r = config.rois[i];
+        if (r.w < f || r.h < f || (size_t)r.x + r.w > config.max_frame_w ||
+            (size_t)r.y + r.h > config.max_frame_h) {
+            ESP_LOGE(TAG, "ROI %zu (%u,%u %ux%u) empty or outside the %ux%u max frame", i, r.x, r.y, r.w, r.h,
+                     config.max_frame_w, config.max_frame_h);
+            return false;
+        }
+    }
+    return true;
+}
+
 CvPipeline::CvPipeline() {
     // Set safe defaults
     m_config.enable_grayscale = true;
 }
 
-CvPipeline::~CvPipeline() {
-    if (m_out_buffer) {
-        heap_caps_free(m_out_buffer);
-        m_out_buffer = nullptr;
+CvPipeline::~CvPipeline() = default;
+
+ArenaSizes CvPipeline::arenaRequirements(const PipelineConfig& config) {
+    // Each block is padded for alignment by ArenaRegion::alloc().
+    ArenaSizes sizes;
+    if (config.roi_count == 0) {
+        sizes.psram = (size_t)config.max_frame_w * config.max_frame_h + 4;
+    }
+    sizes.internal = (size_t)config.max_blobs * sizeof(Blob) + 4
+                   + (size_t)config.label_queue_len * sizeof(uint32_t) + 4;
+    if (config.blob_moments || config.blob_perimeter) {
+        sizes.internal += (size_t)config.max_blobs * sizeof(BlobShape) + 4;
+    }
+    if (config.strip_rows > 0) {
+        sizes.internal += (size_t)config.strip_rows * config.max_frame_w * 2 + 4;
+    }
+    const size_t rois = std::min<size_t>(config.roi_count, kMaxRois);
+    if (rois > 0) {
+        const size_t f = std::max<size_t>(config.downsample_factor, 1);
+        sizes.internal += (size_t)config.max_frame_w + 4;
+        for (size_t i = 0; i < rois; i++) {
+            const RoiConfig& r = config.rois[i];
+            sizes.psram += (size_t)(r.w / f) * (r.h / f) + 4;
+            sizes.internal += (size_t)config.max_blobs * sizeof(Blob) + 4;
+        }
+    }
+    if (config.enable_color) {
+        sizes.internal += 65536 + 4;
+        sizes.psram += (size_t)config.max_frame_w * config.max_frame_h + 4;
+    }
+    if (config.enable_edges) {
+        sizes.internal += 3 * (size_t)config.max_frame_w + 4
+                        + 2 * ((size_t)config.max_frame_w * sizeof(int16_t) + 4);
+        if (config.edge_direction) {
+            sizes.psram += (size_t)config.max_frame_w * config.max_frame_h + 4;
+        }
+    }
+    if (config.blur_radius > 0) {
+        sizes.internal += std::max(config.max_frame_w, config.max_frame_h) + 4;
     }
+    if (pyramidReserved(config)) {
+        const size_t f = config.pyramid_factor;
+        const size_t candidates = (size_t)kPyramidCandidatesPerBlob * config.max_blobs;
+        sizes.psram += ((config.max_frame_w + f - 1) / f) * ((config.max_frame_h + f - 1) / f) + 4;
+        sizes.internal += candidates * sizeof(Blob) + 4
+                        + candidates * sizeof(PyrWindow) + 4
+                        + (size_t)config.max_blobs * sizeof(uint32_t) + 4;
+    }
+    if (config.morph_op != MorphOp::None) {
+        size_t stride = morph::strideWords(config.max_frame_w);
+        sizes.internal += 2 * ((size_t)config.max_frame_h * stride * 4 + 4)          // planes
+                        + ((size_t)config.max_frame_h + morph::kMaxKernel) * stride * 4 + 4 // vHGW
+                        + 3 * stride * 4 + 4;                                          // row scratch
+    }
+    return sizes;
 }
 
-void CvPipeline::configure(const PipelineConfig& config) {
+bool CvPipeline::configure(const PipelineConfig& config) {
+    if (!validateConfig(config)) return false;
+
+    ArenaSizes need = arenaRequirements(config);
+    ArenaSizes have = m_own_arena.capacity();
+
+    // Only go back to the heap if the new config needs more memory.
+    if (have.internal < need.internal || have.psram < need.psram) {
+        if (!m_own_arena.allocate(need)) {
+            ESP_LOGE(TAG, "Failed to allocate pipeline arena (%zu internal + %zu PSRAM bytes)",
+                     need.internal, need.psram);
+            m_own_arena.release();
+        }
+    }
+    return configure(config, m_own_arena);
+}
+
+bool CvPipeline::configure(const PipelineConfig& config, PipelineArena& arena) {
+    if (!validateConfig(config)) return false;
+
     m_config = config;
+    m_arena = &arena;
+    if (!carveArena(arena)) {
+        ESP_LOGE(TAG, "Arena too small for configuration");
+        m_out_buffer = nullptr;
+        m_buffer_alloc_size = 0;
+        m_blobs.init(nullptr, 0);
+        m_shapes.init(nullptr, 0);
+        m_label_queue = nullptr;
+        m_label_queue_len = 0;
+        m_strip_tile = nullptr;
+        m_blur_line = nullptr;
+        m_sobel_rows = nullptr;
+        m_edge_dir = nullptr;
+        m_color_lut = nullptr;
+        m_class_mask = nullptr;
+        m_roi_count = 0;
+        m_roi_line = nullptr;
+        m_pyr_level = nullptr;
+        m_pyr_candidates.init(nullptr, 0);
+        m_pyr_windows = nullptr;
+        m_pyr_seeds = nullptr;
+        return false;
+    }
+    if (m_color_lut) buildColorLut();
+    return true;
+}
+
+bool CvPipeline::carveArena(PipelineArena& arena) {
+    arena.reset();
+
+    // Large, sequentially accessed: PSRAM. Multi-ROI writes per-zone buffers instead.
+    m_buffer_alloc_size = (size_t)m_config.max_frame_w * m_config.max_frame_h;
+    m_out_buffer = nullptr;
+    if (m_config.roi_count == 0) {
+        m_out_buffer = arena.psram().allocArray<uint8_t>(m_buffer_alloc_size);
+    }
+
+    // Small, randomly accessed every frame: internal SRAM
+    Blob* blob_storage = arena.internal().allocArray<Blob>(m_config.max_blobs);
+    m_blobs.init(blob_storage, m_config.max_blobs);
+
+    // Shape descriptors, parallel to m_blobs (only when enabled)
+    BlobShape* shape_storage = nullptr;
+    bool shapes_ok = true;
+    if (m_config.blob_moments || m_config.blob_perimeter) {
+        shape_storage = arena.internal().allocArray<BlobShape>(m_config.max_blobs);
+        shapes_ok = shape_storage != nullptr;
+    }
+    m_shapes.init(shape_storage, shape_storage ? m_config.max_blobs : 0);
+
+    m_label_queue_len = std::max<size_t>(m_config.label_queue_len, 1);
+    m_label_queue = arena.internal().allocArray<uint32_t>(m_label_queue_len);
+
+    // Strip tile: strip_rows source rows of RGB565
+    m_strip_tile = nullptr;
+    bool tile_ok = true;
+    if (m_config.strip_rows > 0) {
+        m_strip_tile = arena.internal().allocArray<uint8_t>((size_t)m_config.strip_rows * m_config.max_frame_w * 2);
+        tile_ok = m_strip_tile != nullptr;
+    }
+
+    // Multi-ROI: one gray line plus an output buffer and blob list per ROI
+    m_roi_count = std::min<size_t>(m_config.roi_count, kMaxRois);
+    m_roi_line = nullptr;
+    bool rois_ok = true;
+    if (m_roi_count > 0) {
+        const size_t f = std::max<size_t>(m_config.downsample_factor, 1);
+        m_roi_line = arena.internal().allocArray<uint8_t>(m_config.max_frame_w);
+        rois_ok = m_roi_line != nullptr;
+        for (size_t i = 0; i < m_roi_count; i++) {
+            const RoiConfig& r = m_config.rois[i];
+            RoiState& st = m_rois[i];
+            st = RoiState();
+            st.buffer = arena.psram().allocArray<uint8_t>((size_t)(r.w / f) * (r.h / f));
+            Blob* storage = arena.internal().allocArray<Blob>(m_config.max_blobs);
+            st.blobs.init(storage, m_config.max_blobs);
+            rois_ok = rois_ok && st.buffer && storage;
+        }
+    }
+
+    // Class LUT (random access per pixel: internal) and per-class label mask
+    m_color_lut = nullptr;
+    m_class_mask = nullptr;
+    bool color_ok = true;
+    if (m_config.enable_color) {
+        m_color_lut = arena.internal().allocArray<uint8_t>(65536);
+        m_class_mask = arena.psram().allocArray<uint8_t>(m_buffer_alloc_size);
+        color_ok = m_color_lut && m_class_mask;
+    }
+
+    // Rolling three-row window for the fused Sobel stage
+    m_sobel_rows = nullptr;
+    m_sobel_sum = m_sobel_diff = nullptr;
+    m_edge_dir = nullptr;
+    bool edges_ok = true;
+    if (m_config.enable_edges) {
+        m_sobel_rows = arena.internal().allocArray<uint8_t>(3 * (size_t)m_config.max_frame_w);
+        m_sobel_sum = arena.internal().allocArray<int16_t>(m_config.max_frame_w);
+        m_sobel_diff = arena.internal().allocArray<int16_t>(m_config.max_frame_w);
+        edges_ok = m_sobel_rows && m_sobel_sum && m_sobel_diff;
+        if (m_config.edge_direction) {
+            m_edge_dir = arena.psram().allocArray<uint8_t>(m_buffer_alloc_size);
+            edges_ok = edges_ok && m_edge_dir;
+        }
+    }
+
+    // One scratch line for the blur (a row, or a gathered column)
+    m_blur_line = nullptr;
+    bool blur_ok = true;
+    if (m_config.blur_radius > 0) {
+        m_blur_line = arena.internal().allocArray<uint8_t>(std::max(m_config.max_frame_w, m_config.max_frame_h));
+        blur_ok = m_blur_line != nullptr;
+    }
+
+    // Pyramid mode: coarse level plus candidate, window and seed lists
+    m_pyr_level = nullptr;
+    m_pyr_windows = nullptr;
+    m_pyr_seeds = nullptr;
+    m_pyr_candidates.init(nullptr, 0);
+    m_pyr_w = m_pyr_h = m_pyr_window_count = 0;
+    bool pyramid_ok = true;
+    if (pyramidReserved(m_config)) {
+        const size_t f = m_config.pyramid_factor;
+        const size_t candidates = (size_t)kPyramidCandidatesPerBlob * m_config.max_blobs;
+        m_pyr_level = arena.psram().allocArray<uint8_t>(((m_config.max_frame_w + f - 1) / f) *
+                                                         ((m_config.max_frame_h + f - 1) / f));
+        Blob* storage = arena.internal().allocArray<Blob>(candidates);
+        m_pyr_candidates.init(storage, storage ? candidates : 0);
+        m_pyr_windows = arena.internal().allocArray<PyrWindow>(candidates);
+        m_pyr_seeds = arena.internal().allocArray<uint32_t>(m_config.max_blobs);
+        pyramid_ok = m_pyr_level && storage && m_pyr_windows && m_pyr_seeds;
+    }
+
+    // Packed bit planes and vHGW scratch for the morphology stage
+    m_morph_planes[0] = m_morph_planes[1] = nullptr;
+    m_morph_ws = morph::Workspace();
+    bool morph_ok = true;
+    if (m_config.morph_op != MorphOp::None) {
+        size_t stride = morph::strideWords(m_config.max_frame_w);
+        m_morph_planes[0] = arena.internal().allocArray<uint32_t>((size_t)m_config.max_frame_h * stride);
+        m_morph_planes[1] = arena.internal().allocArray<uint32_t>((size_t)m_config.max_frame_h * stride);
+        m_morph_ws.vhgw = arena.internal().allocArray<uint32_t>(((size_t)m_config.max_frame_h + morph::kMaxKernel) * stride);
+        m_morph_ws.row = arena.internal().allocArray<uint32_t>(3 * stride);
+        morph_ok = m_morph_planes[0] && m_morph_planes[1] && m_morph_ws.vhgw && m_morph_ws.row;
+    }
+
+    return (m_out_buffer || m_roi_count > 0) && blob_storage && shapes_ok && m_label_queue && tile_ok && rois_ok && color_ok && edges_ok && blur_ok && morph_ok && pyramid_ok;
 }
 
 void CvPipeline::process(camera_fb_t* frame) {
@@ -43,57 +367,113 @@ void CvPipeline::process(camera_fb_t* frame) {
 
     // 1. Reset State
     m_blobs.clear();
+    m_shapes.clear();
+    m_blobs_dropped = 0;
+    m_fg_pixels = 0;
     m_width = frame->width;
     m_height = frame->height;
     size_t needed_size = m_width * m_height;
 
-    // 2. Buffer Management
-    // Allocate in PSRAM (SPIRAM) if available to save internal heap.
-    if (m_buffer_alloc_size < needed_size) {
-        if (m_out_buffer) {
-            heap_caps_free(m_out_buffer);
-        }
+    // 2. Buffer Check
+    // The working buffer was sized from max_frame_w/h at configure() time.
+    if ((!m_out_buffer && m_roi_count == 0) || needed_size > m_buffer_alloc_size ||
+        m_width > m_config.max_frame_w || m_height > m_config.max_frame_h) {
+        ESP_LOGE(TAG, "Frame %zux%zu exceeds configured arena (%zu bytes)",
+                 m_width, m_height, m_buffer_alloc_size);
+        m_width = 0;
+        m_height = 0;
+        return;
+    }
 
-        m_out_buffer = (uint8_t*)heap_caps_malloc(needed_size, MALLOC_CAP_SPIRAM);
-        if (!m_out_buffer) {
-            // Fallback to internal RAM (only works for small resolutions like QVGA)
-            ESP_LOGW(TAG, "PSRAM allocation failed, falling back to DRAM");
-            m_out_buffer = (uint8_t*)heap_caps_malloc(needed_size, MALLOC_CAP_8BIT);
+    // 3. Execution Pipeline
+    m_traffic = MemTraffic();
+    for (auto& t : m_stage_us) t = 0;
+
+    if (m_roi_count > 0) {
+        // Every ROI is extracted, scaled and thresholded in one pass over the frame
+        timeStage(PipelineStage::Grayscale, [&] { runMultiRoi(frame); });
+        if (m_config.enable_blob_detection) {
+            timeStage(PipelineStage::Blobs, [&] { runRoiBlobDetection(); });
+        }
+        m_width = 0;
+        m_height = 0;
+        return;
+    } else if (m_color_lut) {
+        // One LUT read per pixel straight from RGB565, then crop / scale the class mask
+        timeStage(PipelineStage::Grayscale, [&] { convertColor(frame); });
+        if (m_config.enable_roi) {
+            timeStage(PipelineStage::Roi, [&] { applyROI(); });
         }
+        if (m_config.downsample_factor > 1) {
+            timeStage(PipelineStage::Downsample, [&] { applyDownsample(); });
+        }
+    } else if (m_sobel_rows) {
+        // Gray + Sobel (+ edge threshold) fused over a rolling row window of
+        // the ROI at the output sampling
+        timeStage(PipelineStage::Grayscale, [&] { convertSobel(frame); });
+    } else if (m_pyr_level && pyramidActive(m_config)) {
+        // Candidates on a coarse level, then threshold + labeling only in
+        // full-resolution windows around them (stages are timed inside)
+        runPyramid(frame);
+        return;
+    } else if (m_strip_tile) {
+        // Stages 1-4 fused per strip in internal SRAM. The blur needs
+        // neighbouring rows, so with it enabled the strips stop at gray.
+        timeStage(PipelineStage::Grayscale, [&] { runStripExecutor(frame); });
+        if (m_blur_line) {
+            timeStage(PipelineStage::Blur, [&] { applyBlur(); });
+            if (m_config.enable_threshold) {
+                timeStage(PipelineStage::Threshold, [&] { applyThreshold(); });
+            }
+        }
+    } else {
+        // Stage 1: Grayscale (Base Requirement)
+        timeStage(PipelineStage::Grayscale, [&] { convertGrayscale(frame); });
 
-        if (!m_out_buffer) {
-            ESP_LOGE(TAG, "Failed to allocate pipeline buffer (%zu bytes)", needed_size);
-            return;
+        // Stage 2: Region of Interest (Crop)
+        if (m_config.enable_roi) {
+            timeStage(PipelineStage::Roi, [&] { applyROI(); });
         }
-        m_buffer_alloc_size = needed_size;
-    }
 
-    // 3. Execution Pipeline
-    
-    // Stage 1: Grayscale (Base Requirement)
-    convertGrayscale(frame);
+        // Stage 3: Downsampling (Scale)
+        if (m_config.downsample_factor > 1) {
+            timeStage(PipelineStage::Downsample, [&] { applyDownsample(); });
+        }
 
-    // Stage 2: Region of Interest (Crop)
-    if (m_config.enable_roi) {
-        applyROI();
-    }
+        // Stage 3b: Denoise (box blur)
+        if (m_blur_line) {
+            timeStage(PipelineStage::Blur, [&] { applyBlur(); });
+        }
 
-    // Stage 3: Downsampling (Scale)
-    if (m_config.downsample_factor > 1) {
-        applyDownsample();
+        // Stage 4: Thresholding (Binarize)
+        if (m_config.enable_threshold) {
+            timeStage(PipelineStage::Threshold, [&] { applyThreshold(); });
+        }
     }
 
-    // Stage 4: Thresholding (Binarize)
-    if (m_config.enable_threshold) {
-        applyThreshold();
+    // Stage 4b: Morphology (binary mask clean-up)
+    if (producesMask() && m_config.morph_op != MorphOp::None) {
+        timeStage(PipelineStage::Morphology, [&] { applyMorphology(); });
     }
 
     // Stage 5: Blob Analysis
     if (m_config.enable_blob_detection) {
-        runBlobDetection();
+        timeStage(PipelineStage::Blobs, [&] { runBlobDetection(); });
     }
 }
 
+bool CvPipeline::producesMask() const {
+    if (m_color_lut) return false; // class bitmasks, not a 0/255 mask
+    return m_sobel_rows ? m_config.edge_threshold > 0 : m_config.enable_threshold;
+}
+
+template <typename F>
+void CvPipeline::timeStage(PipelineStage stage, F&& fn) {
+    int64_t start = esp_timer_get_time();
+    fn();
+    m_stage_us[(size_t)stage] += esp_timer_get_time() - start;
+}
+
 void CvPipeline::convertGrayscale(const camera_fb_t* fb) {
     // Conversion: RGB565 -> 8-bit Grayscale
     const uint8_t* src = fb->buf;
@@ -101,28 +481,510 @@ void CvPipeline::convertGrayscale(const camera_fb_t* fb) {
     size_t len = fb->width * fb->height;
 
     for (size_t i = 0; i < len; i++) {
-        uint8_t low = *src++;
-        uint8_t high = *src++;
-        uint16_t pixel = (high << 8) | low;
+        *dst++ = rgb565ToLuma(src);
+        src += 2;
+    }
+
+    m_traffic.psram_read += len * 2;
+    m_traffic.psram_write += len;
+}
+
+/// @brief Expand an RGB565 value to 8-bit channels (same rounding as rgb565ToLuma).
+static inline void rgb565ToRgb888(uint16_t pixel, int& r, int& g, int& b) {
+    r = (((pixel >> 11) & 0x1F) * 527 + 23) >> 6;
+    g = (((pixel >> 5) & 0x3F) * 259 + 33) >> 6;
+    b = ((pixel & 0x1F) * 527 + 23) >> 6;
+}
+
+/// @brief True if channel value @p v lies in [lo, hi] (wrapping when lo > hi and @p wraps).
+static inline bool inRange(int v, uint8_t lo, uint8_t hi, bool wraps) {
+    if (wraps && lo > hi) return v >= lo || v <= hi;
+    return v >= lo && v <= hi;
+}
+
+void CvPipeline::buildColorLut() {
+    // Runs once per configure(): every RGB565 value is converted to HSV and
+    // YUV and tested against all classes, so process() needs one read per pixel.
+    const size_t count = std::min<size_t>(m_config.color_class_count, kMaxColorClasses);
+    const int64_t start = esp_timer_get_time();
+
+    for (uint32_t p = 0; p < 65536; p++) {
+        int r, g, b;
+        rgb565ToRgb888((uint16_t)p, r, g, b);
+
+        // HSV, OpenCV scaling (H 0-179)
+        int vmax = std::max(r, std::max(g, b));
+        int vmin = std::min(r, std::min(g, b));
+        int delta = vmax - vmin;
+        int s = vmax ? (255 * delta + vmax / 2) / vmax : 0;
+        int h = 0;
+        if (delta) {
+            if (vmax == r)      h = (30 * (g - b)) / delta;
+            else if (vmax == g) h = 60 + (30 * (b - r)) / delta;
+            else                h = 120 + (30 * (r - g)) / delta;
+            if (h < 0) h += 180;
+        }
+        const int hsv[3] = {h, s, vmax};
+
+        // YUV, BT.601 full range
+        const int yuv[3] = {
+            (77 * r + 150 * g + 29 * b) >> 8,
+            ((-43 * r - 85 * g + 128 * b) >> 8) + 128,
+            ((128 * r - 107 * g - 21 * b) >> 8) + 128,
+        };
+
+        uint8_t bits = 0;
+        for (size_t c = 0; c < count; c++) {
+            const ColorClass& cc = m_config.color_classes[c];
+            const bool is_hsv = cc.space == ColorSpace::HSV;
+            const int* v = is_hsv ? hsv : yuv;
+            if (inRange(v[0], cc.min[0], cc.max[0], is_hsv) &&
+                inRange(v[1], cc.min[1], cc.max[1], false) &&
+                inRange(v[2], cc.min[2], cc.max[2], false)) {
+                bits |= 1u << c;
+            }
+        }
+        m_color_lut[p] = bits;
+    }
+
+    ESP_LOGI(TAG, "Colour LUT built for %zu class(es) in %lld us",
+             count, (long long)(esp_timer_get_time() - start));
+}
+
+void CvPipeline::convertColor(const camera_fb_t* fb) {
+    const uint8_t* src = fb->buf;
+    uint8_t* dst = m_out_buffer;
+    size_t len = fb->width * fb->height;
+
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = m_color_lut[(src[1] << 8) | src[0]];
+        src += 2;
+    }
+
+    m_traffic.psram_read += len * 2;
+    m_traffic.psram_write += len;
+}
+
+/// @brief Sobel magnitude (|gx| + |gy|) / 8, binarised against @p th unless it is 0.
+static inline uint8_t edgePixel(int gx, int gy, uint8_t th) {
+    int mag = ((gx < 0 ? -gx : gx) + (gy < 0 ? -gy : gy)) >> 3;   // 0..255
+    uint8_t bin = mag >= th ? 255 : 0;
+    return th ? bin : (uint8_t)mag;
+}
+
+/// @brief Quantise a gradient to an EdgeDirection bin.
+static inline uint8_t edgeDirection(int gx, int gy) {
+    int ax = gx < 0 ? -gx : gx;
+    int ay = gy < 0 ? -gy : gy;
+    // tan(22.5) ~ 106/256, tan(67.5) ~ 618/256
+    if ((ay << 8) <= ax * 106) return EdgeDir0;
+    if ((ay << 8) >= ax * 618) return EdgeDir90;
+    return (gx ^ gy) >= 0 ? EdgeDir45 : EdgeDir135;
+}
+
+/// @brief Convert every @p step-th pixel of one RGB565 row to gray.
+static void lumaRow(const uint8_t* __restrict src, uint8_t* __restrict dst, size_t width, size_t step) {
+    for (size_t x = 0; x < width; x++) dst[x] = rgb565ToLuma(src + 2 * x * step);
+}
+
+void CvPipeline::convertSobel(const camera_fb_t* fb) {
+    // The gradient is taken on the grid the intensity path would threshold:
+    // the ROI sampled every downsample_factor pixels. Sampling the gray
+    // image rather than the finished edge mask keeps every step edge at
+    // least one output pixel wide, and nothing outside the ROI is read.
+    //
+    // Only three gray rows exist at a time: row y + 1 is converted into the
+    // slot of row y - 2 just before output row y is computed. Borders are
+    // replicated. The kernel is split into a vertical pass (smooth / diff
+    // per column) and a horizontal pass over those two lines; both are
+    // branch-free loops over contiguous arrays so the compiler can vectorise
+    // them.
+    size_t rx, ry, rw, rh;
+    sourceWindow(m_config, fb->width, fb->height, rx, ry, rw, rh);
+    const size_t step = std::max<size_t>(m_config.downsample_factor, 1);
+    const size_t w = rw / step;
+    const size_t h = rh / step;
+    m_width = w;
+    m_height = h;
+    if (w == 0 || h == 0) return;
+
+    auto source = [&](size_t y) { return fb->buf + ((ry + y * step) * fb->width + rx) * 2; };
+
+    const uint8_t th = m_config.edge_threshold;
+    uint8_t* rows[3] = {m_sobel_rows, m_sobel_rows + w, m_sobel_rows + 2 * w};
+    int16_t* __restrict sum = m_sobel_sum;
+    int16_t* __restrict diff = m_sobel_diff;
+
+    lumaRow(source(0), rows[1], w, step);
+    if (h > 1) lumaRow(source(1), rows[2], w, step);
+    else memcpy(rows[2], rows[1], w);
+    memcpy(rows[0], rows[1], w);
+
+    for (size_t y = 0; y < h; y++) {
+        const uint8_t* __restrict top = rows[0];
+        const uint8_t* __restrict mid = rows[1];
+        const uint8_t* __restrict bot = rows[2];
+
+        // Vertical pass: [1 2 1]^T and [-1 0 1]^T
+        for (size_t x = 0; x < w; x++) {
+            sum[x] = (int16_t)(top[x] + 2 * mid[x] + bot[x]);
+            diff[x] = (int16_t)(bot[x] - top[x]);
+        }
+
+        // Horizontal pass: gx = [-1 0 1] * sum, gy = [1 2 1] * diff
+        uint8_t* __restrict out = m_out_buffer + y * w;
+        if (w == 1) {
+            out[0] = edgePixel(0, 4 * diff[0], th);
+        } else {
+            out[0] = edgePixel(sum[1] - sum[0], 3 * diff[0] + diff[1], th);
+            for (size_t x = 1; x + 1 < w; x++) {
+                out[x] = edgePixel(sum[x + 1] - sum[x - 1], diff[x - 1] + 2 * diff[x] + diff[x + 1], th);
+            }
+            out[w - 1] = edgePixel(sum[w - 1] - sum[w - 2], diff[w - 2] + 3 * diff[w - 1], th);
+        }
+
+        if (m_edge_dir) {
+            uint8_t* __restrict dir = m_edge_dir + y * w;
+            for (size_t x = 0; x < w; x++) {
+                size_t l = x > 0 ? x - 1 : 0;
+                size_t r = x + 1 < w ? x + 1 : w - 1;
+                dir[x] = edgeDirection(sum[r] - sum[l], diff[l] + 2 * diff[x] + diff[r]);
+            }
+        }
+
+        // Slide the window: the oldest slot receives row y + 2
+        uint8_t* recycled = rows[0];
+        rows[0] = rows[1];
+        rows[1] = rows[2];
+        rows[2] = recycled;
+        if (y + 2 < h) lumaRow(source(y + 2), rows[2], w, step);
+        else memcpy(rows[2], rows[1], w);
+    }
+
+    size_t len = w * h;
+    m_traffic.psram_read += len * 2;
+    m_traffic.psram_write += m_edge_dir ? 2 * len : len;
+}
+
+void CvPipeline::runStripExecutor(const camera_fb_t* fb) {
+    // Effective source window (same clamping as applyROI)
+    size_t rx, ry, rw, rh;
+    sourceWindow(m_config, fb->width, fb->height, rx, ry, rw, rh);
+
+    const size_t factor = std::max<size_t>(m_config.downsample_factor, 1);
+    const size_t out_w = rw / factor;
+    const size_t out_h = rh / factor;
+    const size_t strip = m_config.strip_rows;
+    const size_t row_bytes = rw * 2;
+
+    const uint8_t th = m_config.threshold_val;
+    const bool do_threshold = m_config.enable_threshold && !m_blur_line;
+    const bool inv = m_config.invert;
 
-        // Extract RGB565 components
-        uint8_t r = (pixel >> 11) & 0x1F;
-        uint8_t g = (pixel >> 5) & 0x3F;
-        uint8_t b = pixel & 0x1F;
+    uint8_t* dst = m_out_buffer;
+
+    for (size_t y0 = 0; y0 < out_h; y0 += strip) {
+        size_t rows = std::min(strip, out_h - y0);
+
+        // Pull: copy only the source rows the output needs (contiguous ROI spans,
+        // one burst per row) from the PSRAM framebuffer into the internal tile.
+        for (size_t k = 0; k < rows; k++) {
+            size_t src_y = ry + (y0 + k) * factor;
+            memcpy(m_strip_tile + k * row_bytes, fb->buf + (src_y * fb->width + rx) * 2, row_bytes);
+        }
+
+        // Per-pixel stages on the tile: convert -> downsample -> threshold
+        for (size_t k = 0; k < rows; k++) {
+            const uint8_t* src = m_strip_tile + k * row_bytes;
+            for (size_t x = 0; x < out_w; x++) {
+                uint8_t v = rgb565ToLuma(src + x * factor * 2);
+                if (do_threshold) {
+                    bool pass = (v >= th);
+                    if (inv) pass = !pass;
+                    v = pass ? 255 : 0;
+                }
+                *dst++ = v;
+            }
+        }
+    }
 
-        // Approximate Luminance:
-        // Scaled to 8-bit range approx (R*2 + G*4 + B) / 8
-        // Higher precision: 0.299R + 0.587G + 0.114B
-        
-        // We expand 5/6-bit to 8-bit first for better accuracy
-        uint16_t r8 = (r * 527 + 23) >> 6;
-        uint16_t g8 = (g * 259 + 33) >> 6;
-        uint16_t b8 = (b * 527 + 23) >> 6;
+    // Only the compact result goes back to PSRAM.
+    m_traffic.psram_read += out_h * row_bytes;
+    m_traffic.psram_write += out_w * out_h;
+
+    m_width = out_w;
+    m_height = out_h;
+}
+
+void CvPipeline::runMultiRoi(const camera_fb_t* fb) {
+    const size_t fw = fb->width;
+    const size_t fh = fb->height;
+    const size_t factor = std::max<size_t>(m_config.downsample_factor, 1);
+    const bool do_threshold = m_config.enable_threshold;
+    const bool inv = m_config.invert;
+
+    // Clamp every ROI to this frame (and to the buffer sized at configure()).
+    for (size_t i = 0; i < m_roi_count; i++) {
+        const RoiConfig& r = m_config.rois[i];
+        RoiState& st = m_rois[i];
+        st.blobs.clear();
+        st.x = std::min<size_t>(r.x, fw);
+        st.y = std::min<size_t>(r.y, fh);
+        st.width = std::min<size_t>(r.w, fw - st.x) / factor;
+        st.height = std::min<size_t>(r.h, fh - st.y) / factor;
+    }
+
+    // Single traversal: each sensor row is visited once and only the spans
+    // the ROIs sampling it need are converted, overlaps once; every ROI then
+    // thresholds its own columns out of that gray line.
+    auto samples = [&](const RoiState& st, size_t y) {
+        return st.width > 0 && y >= st.y && y < st.y + st.height * factor && (y - st.y) % factor == 0;
+    };
+
+    for (size_t y = 0; y < fh; y++) {
+        // Active spans, sorted by start (at most kMaxRois: insertion sort)
+        size_t span_x0[kMaxRois], span_x1[kMaxRois];
+        size_t spans = 0;
+        for (size_t i = 0; i < m_roi_count; i++) {
+            const RoiState& st = m_rois[i];
+            if (!samples(st, y)) continue;
+            size_t x0 = st.x, x1 = st.x + (st.width - 1) * factor + 1;
+            size_t k = spans++;
+            for (; k > 0 && span_x0[k - 1] > x0; k--) {
+                span_x0[k] = span_x0[k - 1];
+                span_x1[k] = span_x1[k - 1];
+            }
+            span_x0[k] = x0;
+            span_x1[k] = x1;
+        }
+        if (spans == 0) continue;
+
+        // Convert the union of the spans
+        size_t done = 0;
+        for (size_t k = 0; k < spans; k++) {
+            size_t x0 = std::max(span_x0[k], done);
+            size_t x1 = span_x1[k];
+            if (x0 >= x1) continue;
+            const uint8_t* src = fb->buf + (y * fw + x0) * 2;
+            for (size_t x = x0; x < x1; x++, src += 2) m_roi_line[x] = rgb565ToLuma(src);
+            m_traffic.psram_read += (x1 - x0) * 2;
+            done = x1;
+        }
+
+        for (size_t i = 0; i < m_roi_count; i++) {
+            RoiState& st = m_rois[i];
+            if (!samples(st, y)) continue;
+            const uint8_t* line = m_roi_line + st.x;
+            uint8_t* dst = st.buffer + ((y - st.y) / factor) * st.width;
+            const uint8_t th = m_config.rois[i].threshold_val;
+            for (size_t x = 0; x < st.width; x++) {
+                uint8_t v = line[x * factor];
+                if (do_threshold) {
+                    bool pass = (v >= th);
+                    if (inv) pass = !pass;
+                    v = pass ? 255 : 0;
+                }
+                dst[x] = v;
+            }
+            m_traffic.psram_write += st.width;
+        }
+    }
+}
 
-        *dst++ = (uint8_t)((r8 * 77 + g8 * 150 + b8 * 29) >> 8);
+void CvPipeline::runRoiBlobDetection() {
+    for (size_t i = 0; i < m_roi_count; i++) {
+        RoiState& st = m_rois[i];
+        LabelTarget t = {st.buffer, st.width, st.height, m_config.rois[i].min_blob_area, 0, &st.blobs, nullptr};
+        m_traffic.psram_read += st.width * st.height;
+        labelBlobs<false, false>(t);
     }
 }
 
+void CvPipeline::runPyramid(const camera_fb_t* fb) {
+    // The fine level is what the normal path would threshold: the ROI
+    // (clamped as in applyROI) sampled every downsample_factor pixels. It
+    // is never materialised; pixels are converted straight from the frame.
+    const size_t fw = fb->width;
+    size_t rx, ry, rw, rh;
+    sourceWindow(m_config, fw, fb->height, rx, ry, rw, rh);
+    const size_t ds = std::max<size_t>(m_config.downsample_factor, 1);
+    const size_t W = rw / ds;
+    const size_t H = rh / ds;
+    const size_t f = m_config.pyramid_factor;
+    m_width = W;
+    m_height = H;
+    m_pyr_w = (W + f - 1) / f;
+    m_pyr_h = (H + f - 1) / f;
+    m_pyr_window_count = 0;
+    if (W == 0 || H == 0) return;
+
+    const uint8_t* src = fb->buf;
+    const uint8_t th = m_config.threshold_val;
+    const bool inv = m_config.invert;
+    auto fine = [&](size_t x, size_t y) {
+        return (rgb565ToLuma(src + ((ry + y * ds) * fw + rx + x * ds) * 2) >= th) != inv;
+    };
+
+    // 1. Candidate level: every f-th fine pixel in both directions, so any
+    //    object containing an f x f square is hit at least once.
+    bool overflow = false;
+    timeStage(PipelineStage::Grayscale, [&] {
+        uint8_t* dst = m_pyr_level;
+        for (size_t v = 0; v < m_pyr_h; v++) {
+            for (size_t u = 0; u < m_pyr_w; u++) {
+                *dst++ = fine(u * f, v * f) ? kForeground : 0;
+            }
+        }
+        m_traffic.psram_read += 2 * m_pyr_w * m_pyr_h;
+        m_traffic.psram_write += m_pyr_w * m_pyr_h;
+        m_traffic.psram_read += m_pyr_w * m_pyr_h; // labeling scan
+
+        m_pyr_candidates.clear();
+        LabelTarget t = {m_pyr_level, m_pyr_w, m_pyr_h, 1, 0, &m_pyr_candidates, nullptr};
+        labelBlobs<false, false>(t);
+        overflow = m_blobs_dropped > 0;
+        m_blobs_dropped = 0;
+        m_fg_pixels = 0;
+    });
+
+    // 2. Windows: each candidate's footprint up to the neighbouring samples.
+    //    A window is grown while foreground touches one of its inner edges
+    //    and merged with any window it overlaps, so every object found
+    //    lies wholly inside exactly one window.
+    size_t n = 0;
+    timeStage(PipelineStage::Threshold, [&] {
+        if (overflow) {
+            // Too many candidates to track: refine the whole level
+            m_pyr_windows[n++] = {0, 0, (uint16_t)(W - 1), (uint16_t)(H - 1)};
+        } else {
+            for (const Blob& c : m_pyr_candidates) {
+                PyrWindow w;
+                w.x0 = (uint16_t)(c.x * f + 1 > f ? c.x * f + 1 - f : 0);
+                w.y0 = (uint16_t)(c.y * f + 1 > f ? c.y * f + 1 - f : 0);
+                w.x1 = (uint16_t)std::min((c.x + c.w - 1) * f + f - 1, W - 1);
+                w.y1 = (uint16_t)std::min((c.y + c.h - 1) * f + f - 1, H - 1);
+                m_pyr_windows[n++] = w;
+            }
+        }
+
+        size_t edge_reads = 0;
+        auto rowHit = [&](size_t y, size_t x0, size_t x1) {
+            for (size_t x = x0; x <= x1; x++) {
+                edge_reads++;
+                if (fine(x, y)) return true;
+            }
+            return false;
+        };
+        auto colHit = [&](size_t x, size_t y0, size_t y1) {
+            for (size_t y = y0; y <= y1; y++) {
+                edge_reads++;
+                if (fine(x, y)) return true;
+            }
+            return false;
+        };
+
+        bool changed = !overflow;
+        while (changed) {
+            changed = false;
+            for (size_t i = 0; i < n; i++) {
+                PyrWindow& w = m_pyr_windows[i];
+                bool grew = true;
+                while (grew) {
+                    grew = false;
+                    if (w.x0 > 0 && colHit(w.x0, w.y0, w.y1)) {
+                        w.x0 = (uint16_t)(w.x0 > f ? w.x0 - f : 0); grew = true;
+                    }
+                    if ((size_t)w.x1 + 1 < W && colHit(w.x1, w.y0, w.y1)) {
+                        w.x1 = (uint16_t)std::min<size_t>(w.x1 + f, W - 1); grew = true;
+                    }
+                    if (w.y0 > 0 && rowHit(w.y0, w.x0, w.x1)) {
+                        w.y0 = (uint16_t)(w.y0 > f ? w.y0 - f : 0); grew = true;
+                    }
+                    if ((size_t)w.y1 + 1 < H && rowHit(w.y1, w.x0, w.x1)) {
+                        w.y1 = (uint16_t)std::min<size_t>(w.y1 + f, H - 1); grew = true;
+                    }
+                }
+            }
+            // A merged window has new edges, so check again after any merge
+            for (size_t i = 0; i < n; i++) {
+                for (size_t j = i + 1; j < n;) {
+                    PyrWindow& a = m_pyr_windows[i];
+                    const PyrWindow& b = m_pyr_windows[j];
+                    if (a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1) {
+                        a.x0 = std::min(a.x0, b.x0);
+                        a.y0 = std::min(a.y0, b.y0);
+                        a.x1 = std::max(a.x1, b.x1);
+                        a.y1 = std::max(a.y1, b.y1);
+                        m_pyr_windows[j] = m_pyr_windows[--n];
+                        changed = true;
+                    } else {
+                        j++;
+                    }
+                }
+            }
+        }
+        m_traffic.psram_read += 2 * edge_reads;
+    });
+    m_pyr_window_count = n;
+
+    // 3. Full-resolution threshold + labeling per window, in window-local
+    //    buffers; blobs come out in fine-level coordinates.
+    const bool moments = m_config.blob_moments;
+    const bool perimeter = m_config.blob_perimeter;
+    for (size_t i = 0; i < n; i++) {
+        const PyrWindow w = m_pyr_windows[i];
+        const size_t ww = w.x1 - w.x0 + 1;
+        const size_t wh = w.y1 - w.y0 + 1;
+
+        timeStage(PipelineStage::Threshold, [&] {
+            uint8_t* dst = m_out_buffer;
+            for (size_t y = w.y0; y <= w.y1; y++) {
+                for (size_t x = w.x0; x <= w.x1; x++) {
+                    *dst++ = fine(x, y) ? kForeground : 0;
+                }
+            }
+            m_traffic.psram_read += 2 * ww * wh;
+            m_traffic.psram_write += ww * wh;
+        });
+
+        timeStage(PipelineStage::Blobs, [&] {
+            LabelTarget t = {m_out_buffer, ww, wh, m_config.min_blob_area, 0, &m_blobs, &m_shapes,
+                             w.x0, w.y0, m_pyr_seeds, W};
+            m_traffic.psram_read += ww * wh;
+            if (moments && perimeter) labelBlobs<true, true>(t);
+            else if (moments)         labelBlobs<true, false>(t);
+            else if (perimeter)       labelBlobs<false, true>(t);
+            else                      labelBlobs<false, false>(t);
+        });
+    }
+
+    // 4. Windows are visited in candidate order; restore the raster order
+    //    of each blob's first pixel, which is what a full-frame scan reports.
+    timeStage(PipelineStage::Blobs, [&] {
+        const bool shapes = m_shapes.size() == m_blobs.size();
+        for (size_t i = 1; i < m_blobs.size(); i++) {
+            for (size_t j = i; j > 0 && m_pyr_seeds[j - 1] > m_pyr_seeds[j]; j--) {
+                std::swap(m_pyr_seeds[j - 1], m_pyr_seeds[j]);
+                std::swap(m_blobs[j - 1], m_blobs[j]);
+                if (shapes) std::swap(m_shapes[j - 1], m_shapes[j]);
+            }
+        }
+    });
+}
+
+Blob CvPipeline::roiBlobToSensor(size_t i, const Blob& b) const {
+    const RoiState& st = m_rois[i];
+    const uint16_t f = std::max<uint16_t>(m_config.downsample_factor, 1);
+    Blob s = b;
+    s.x = st.x + b.x * f;
+    s.y = st.y + b.y * f;
+    s.w = b.w * f;
+    s.h = b.h * f;
+    s.cx = st.x + b.cx * f;
+    s.cy = st.y + b.cy * f;
+    return s;
+}
+
 void CvPipeline::applyROI() {
     uint16_t rx = std::min((size_t)m_config.roi_x, m_width - 1);
     uint16_t ry = std::min((size_t)m_config.roi_y, m_height - 1);
@@ -141,6 +1003,9 @@ void CvPipeline::applyROI() {
         src_base += m_width;
     }
 
+    m_traffic.psram_read += (size_t)rw * rh;
+    m_traffic.psram_write += (size_t)rw * rh;
+
     m_width = rw;
     m_height = rh;
 }
@@ -161,10 +1026,61 @@ void CvPipeline::applyDownsample() {
         }
     }
 
+    m_traffic.psram_read += new_w * new_h;
+    m_traffic.psram_write += new_w * new_h;
+
     m_width = new_w;
     m_height = new_h;
 }
 
+/// @brief Sliding box sum over @p line (edges replicated), written to @p out with stride @p step.
+static void boxLine(const uint8_t* line, uint8_t* out, size_t step, size_t len, int r, uint32_t recip) {
+    const int last = (int)len - 1;
+
+    // Window [-r, r] around x = 0, clamped to the line
+    uint32_t sum = 0;
+    for (int i = -r; i <= r; i++) sum += line[std::min(std::max(i, 0), last)];
+
+    for (int x = 0; x <= last; x++) {
+        *out = (uint8_t)((sum * recip + (1u << 23)) >> 24);
+        out += step;
+        sum += line[std::min(x + r + 1, last)];
+        sum -= line[std::max(x - r, 0)];
+    }
+}
+
+void CvPipeline::applyBlur() {
+    // Separable box filter with running sums: each pixel costs one add and
+    // one subtract per direction whatever the radius. Rows are filtered
+    // through the scratch line; columns are gathered into it, filtered and
+    // scattered back, so the frame is blurred in place.
+    if (m_width == 0 || m_height == 0) return;
+
+    const int r = m_config.blur_radius;
+    // 8.24 reciprocal of the window, rounded. With n = 2r+1 and sum <= 255n,
+    // sum * recip <= 255 * (2^24 + r) < 2^32 - 2^23, and the result stays
+    // within 255r / 2^24 < 0.004 of sum / n, so a white window gives exactly 255.
+    const uint32_t recip = ((1u << 24) + r) / (2 * r + 1);
+    const size_t passes = std::max<size_t>(m_config.blur_passes, 1);
+    const size_t len = m_width * m_height;
+
+    for (size_t p = 0; p < passes; p++) {
+        for (size_t y = 0; y < m_height; y++) {
+            uint8_t* row = m_out_buffer + y * m_width;
+            memcpy(m_blur_line, row, m_width);
+            boxLine(m_blur_line, row, 1, m_width, r, recip);
+        }
+        for (size_t x = 0; x < m_width; x++) {
+            uint8_t* col = m_out_buffer + x;
+            for (size_t y = 0; y < m_height; y++) m_blur_line[y] = col[y * m_width];
+            boxLine(m_blur_line, col, m_width, m_height, r, recip);
+        }
+    }
+
+    m_traffic.psram_read += 2 * len * passes;
+    m_traffic.psram_write += 2 * len * passes;
+}
+
 void CvPipeline::applyThreshold() {
     size_t len = m_width * m_height;
     uint8_t th = m_config.threshold_val;
@@ -176,75 +1092,274 @@ void CvPipeline::applyThreshold() {
         if (inv) pass = !pass;
         m_out_buffer[i] = pass ? 255 : 0;
     }
+
+    m_traffic.psram_read += len;
+    m_traffic.psram_write += len;
+}
+
+void CvPipeline::applyMorphology() {
+    morph::BitPlane a, b;
+    a.width = b.width = m_width;
+    a.height = b.height = m_height;
+    a.stride = b.stride = morph::strideWords(m_width);
+    a.words = m_morph_planes[0];
+    b.words = m_morph_planes[1];
+
+    const uint8_t kw = m_config.morph_kernel_w;
+    const uint8_t kh = m_config.morph_kernel_h;
+
+    morph::pack(m_out_buffer, a);
+    switch (m_config.morph_op) {
+        case MorphOp::Erode:
+            morph::erode(a, b, kw, kh, m_morph_ws);
+            break;
+        case MorphOp::Dilate:
+            morph::dilate(a, b, kw, kh, m_morph_ws);
+            break;
+        case MorphOp::Open:   // removes speckles smaller than the kernel
+            morph::erode(a, b, kw, kh, m_morph_ws);
+            morph::dilate(b, a, kw, kh, m_morph_ws);
+            std::swap(a, b);
+            break;
+        case MorphOp::Close:  // fills holes and gaps smaller than the kernel
+            morph::dilate(a, b, kw, kh, m_morph_ws);
+            morph::erode(b, a, kw, kh, m_morph_ws);
+            std::swap(a, b);
+            break;
+        case MorphOp::None:
+            return;
+    }
+    morph::unpack(b, m_out_buffer);
+
+    // Packed planes live in internal SRAM; only the mask round-trips PSRAM.
+    m_traffic.psram_read += m_width * m_height;
+    m_traffic.psram_write += m_width * m_height;
+}
+
+int CvPipeline::storeBlob(const LabelTarget& t, const Blob& b, const BlobShape* shape) {
+    FixedVector<Blob>& blobs = *t.blobs;
+    const bool with_shape = shape && t.shapes && t.shapes->capacity() > 0;
+    if (blobs.push_back(b)) {
+        if (with_shape) t.shapes->push_back(*shape);
+        return (int)blobs.size() - 1;
+    }
+
+    m_blobs_dropped++;
+    if (m_config.blob_overflow == BlobOverflowPolicy::KeepLargest && !blobs.empty()) {
+        Blob* smallest = std::min_element(blobs.begin(), blobs.end(),
+            [](const Blob& a, const Blob& c) { return a.area < c.area; });
+        if (smallest->area < b.area) {
+            *smallest = b;
+            if (with_shape) (*t.shapes)[smallest - blobs.begin()] = *shape;
+            return (int)(smallest - blobs.begin());
+        }
+    }
+    return -1;
 }
 
 void CvPipeline::runBlobDetection() {
+    // Traffic model: one full scan; neighbour reads of blob pixels are not counted.
+    m_traffic.psram_read += m_width * m_height;
+
+    // Descriptor accumulation is compiled out of the default path.
+    const bool moments = m_config.blob_moments;
+    const bool perimeter = m_config.blob_perimeter;
+    auto label = [&](uint8_t* mask, uint8_t class_id) {
+        LabelTarget t = {mask, m_width, m_height, m_config.min_blob_area, class_id, &m_blobs, &m_shapes};
+        if (moments && perimeter) labelBlobs<true, true>(t);
+        else if (moments)         labelBlobs<true, false>(t);
+        else if (perimeter)       labelBlobs<false, true>(t);
+        else                      labelBlobs<false, false>(t);
+    };
+
+    if (!m_color_lut) {
+        label(m_out_buffer, 0);
+        return;
+    }
+
+    // Colour mode: label each class from its own 0/255 mask so the class
+    // bitmask in the working buffer survives for the next class.
+    const size_t len = m_width * m_height;
+    const size_t count = std::min<size_t>(m_config.color_class_count, kMaxColorClasses);
+    for (size_t c = 0; c < count; c++) {
+        const uint8_t bit = 1u << c;
+        for (size_t i = 0; i < len; i++) {
+            m_class_mask[i] = (m_out_buffer[i] & bit) ? kForeground : 0;
+        }
+        m_traffic.psram_read += 2 * len;
+        m_traffic.psram_write += len;
+        label(m_class_mask, (uint8_t)c);
+    }
+}
+
+/// @brief Fill @p shape from moment sums (sub-pixel centroid, orientation, eccentricity).
+///
+/// The second-order sums are taken relative to (@p ox, @p oy), a pixel of the
+/// blob, so the products stay small; the variances are then formed in double.
+/// Raw frame-coordinate sums lose the result to cancellation at SVGA and above.
+static void finishMoments(BlobShape& shape, uint32_t area, uint32_t sum_x, uint32_t sum_y,
+                          uint16_t ox, uint16_t oy, int64_t sum_xx, int64_t sum_yy, int64_t sum_xy) {
+    const double n = area;
+    const double mx = sum_x / n;
+    const double my = sum_y / n;
+    const double dx = mx - ox;
+    const double dy = my - oy;
+
+    // Central second-order moments, normalised by area
+    float mu20 = (float)(sum_xx / n - dx * dx);
+    float mu02 = (float)(sum_yy / n - dy * dy);
+    float mu11 = (float)(sum_xy / n - dx * dy);
+
+    // Eigenvalues of the covariance matrix = squared semi-axis scales
+    float half_trace = 0.5f * (mu20 + mu02);
+    float root = 0.5f * std::sqrt(4.0f * mu11 * mu11 + (mu20 - mu02) * (mu20 - mu02));
+    float major = half_trace + root;
+    float minor = half_trace - root;
+
+    shape.cx = (float)mx;
+    shape.cy = (float)my;
+    shape.mu20 = mu20;
+    shape.mu02 = mu02;
+    shape.mu11 = mu11;
+    shape.orientation = 0.5f * std::atan2(2.0f * mu11, mu20 - mu02);
+    shape.eccentricity = major > 0.0f ? std::sqrt(std::max(0.0f, 1.0f - minor / major)) : 0.0f;
+}
+
+template <bool Moments, bool Perimeter>
+void CvPipeline::labelBlobs(const LabelTarget& t) {
     // Algorithm: Queue-based Flood Fill (Scanline or recursive is risky on stack)
-    if (m_width * m_height == 0) return;
+    // The queue is a fixed ring in internal SRAM. If it fills up, newly found
+    // pixels are marked kPending instead and picked up by rescanning the blob's
+    // bounding box once the queue drains, so results never depend on its size.
+    uint8_t* mask = t.mask;
+    const size_t width = t.width;
+    const size_t height = t.height;
+    if (width * height == 0 || !m_label_queue) return;
 
-    size_t len = m_width * m_height;
-    std::queue<std::pair<uint16_t, uint16_t>> q;
+    const size_t len = width * height;
+    const size_t qcap = m_label_queue_len;
+    uint32_t* q = m_label_queue;
+
+    // The perimeter test must tell labelled pixels from background, so they
+    // are marked kLabelled instead of being cleared.
+    const uint8_t visited = Perimeter ? kLabelled : 0;
 
     for (size_t i = 0; i < len; i++) {
         // Find a starting white pixel
-        if (m_out_buffer[i] == 255) {
-            uint16_t start_x = i % m_width;
-            uint16_t start_y = i / m_width;
-
-            Blob b = {start_x, start_y, 0, 0, 0, 0, 0};
-            uint16_t min_x = start_x, max_x = start_x;
-            uint16_t min_y = start_y, max_y = start_y;
-            uint32_t sum_x = 0, sum_y = 0;
-
-            q.push({start_x, start_y});
-            m_out_buffer[i] = 0; // Mark visited (destructive)
-
-            while (!q.empty()) {
-                auto p = q.front();
-                q.pop();
-
-                uint16_t cx = p.first;
-                uint16_t cy = p.second;
-
-                // Accumulate statistics
-                b.area++;
-                sum_x += cx;
-                sum_y += cy;
-
-                if (cx < min_x) min_x = cx;
-                if (cx > max_x) max_x = cx;
-                if (cy < min_y) min_y = cy;
-                if (cy > max_y) max_y = cy;
-
-                // Check 4-connected neighbors
-                const int dx[] = {1, -1, 0, 0};
-                const int dy[] = {0, 0, 1, -1};
-
-                for (int k = 0; k < 4; k++) {
-                    int nx = cx + dx[k];
-                    int ny = cy + dy[k];
-
-                    // Bounds check
-                    if (nx >= 0 && nx < (int)m_width && ny >= 0 && ny < (int)m_height) {
-                        size_t nidx = ny * m_width + nx;
-                        if (m_out_buffer[nidx] == 255) {
-                            m_out_buffer[nidx] = 0; // Mark visited
-                            q.push({(uint16_t)nx, (uint16_t)ny});
+        if (mask[i] != kForeground) continue;
+
+        uint16_t start_x = i % width;
+        uint16_t start_y = i / width;
+
+        Blob b = {start_x, start_y, 0, 0, 0, 0, 0, t.class_id};
+        uint16_t min_x = start_x, max_x = start_x;
+        uint16_t min_y = start_y, max_y = start_y;
+        uint32_t sum_x = 0, sum_y = 0;
+        int64_t sum_xx = 0, sum_yy = 0, sum_xy = 0;   // Relative to (start_x, start_y)
+        uint32_t boundary = 0;
+
+        size_t head = 0, count = 0;
+        size_t pending = 0;
+
+        auto enqueue = [&](size_t idx) {
+            if (count < qcap) {
+                mask[idx] = visited; // Mark visited (destructive)
+                q[(head + count) % qcap] = (uint32_t)idx;
+                count++;
+            } else {
+                mask[idx] = kPending;
+                pending++;
+            }
+        };
+
+        enqueue(i);
+
+        while (count > 0 || pending > 0) {
+            if (count == 0) {
+                // Queue overflowed earlier: pending pixels touch the blob, so
+                // they lie within its bounding box grown by one pixel.
+                size_t x0 = min_x > 0 ? min_x - 1 : 0;
+                size_t y0 = min_y > 0 ? min_y - 1 : 0;
+                size_t x1 = std::min<size_t>(max_x + 1, width - 1);
+                size_t y1 = std::min<size_t>(max_y + 1, height - 1);
+                for (size_t y = y0; y <= y1 && count < qcap; y++) {
+                    for (size_t x = x0; x <= x1 && count < qcap; x++) {
+                        size_t idx = y * width + x;
+                        if (mask[idx] == kPending) {
+                            pending--;
+                            enqueue(idx);
                         }
                     }
                 }
+                if (count == 0) break; // Defensive: nothing left to resolve
             }
 
-            // Store valid blobs
-            if (b.area >= m_config.min_blob_area) {
-                b.x = min_x;
-                b.y = min_y;
-                b.w = max_x - min_x + 1;
-                b.h = max_y - min_y + 1;
-                b.cx = sum_x / b.area;
-                b.cy = sum_y / b.area;
-                m_blobs.push_back(b);
+            size_t idx = q[head];
+            head = (head + 1) % qcap;
+            count--;
+
+            size_t cx = idx % width;
+            size_t cy = idx / width;
+
+            // Accumulate statistics
+            b.area++;
+            sum_x += cx;
+            sum_y += cy;
+            if (Moments) {
+                const int32_t dx = (int32_t)cx - start_x;
+                const int32_t dy = (int32_t)cy - start_y;
+                sum_xx += (int64_t)dx * dx;
+                sum_yy += (int64_t)dy * dy;
+                sum_xy += (int64_t)dx * dy;
+            }
+
+            if (cx < min_x) min_x = cx;
+            if (cx > max_x) max_x = cx;
+            if (cy < min_y) min_y = cy;
+            if (cy > max_y) max_y = cy;
+
+            // A boundary pixel has a 4-neighbour that is background or off-image.
+            if (Perimeter) {
+                bool edge = cx == 0 || cy == 0 || cx + 1 >= width || cy + 1 >= height ||
+                            mask[idx + 1] == 0 || mask[idx - 1] == 0 ||
+                            mask[idx + width] == 0 || mask[idx - width] == 0;
+                boundary += edge;
+            }
+
+            // Check 4-connected neighbors
+            if (cx + 1 < width  && mask[idx + 1] == kForeground) enqueue(idx + 1);
+            if (cx > 0            && mask[idx - 1] == kForeground) enqueue(idx - 1);
+            if (cy + 1 < height && mask[idx + width] == kForeground) enqueue(idx + width);
+            if (cy > 0            && mask[idx - width] == kForeground) enqueue(idx - width);
+        }
+
+        m_fg_pixels += b.area;
+
+        // Store valid blobs
+        if (b.area >= t.min_area) {
+            b.x = min_x + t.off_x;
+            b.y = min_y + t.off_y;
+            b.w = max_x - min_x + 1;
+            b.h = max_y - min_y + 1;
+            b.cx = sum_x / b.area + t.off_x;
+            b.cy = sum_y / b.area + t.off_y;
+
+            int stored;
+            if (Moments || Perimeter) {
+                BlobShape shape = {};
+                if (Moments) {
+                    finishMoments(shape, b.area, sum_x, sum_y, start_x, start_y, sum_xx, sum_yy, sum_xy);
+                    shape.cx += t.off_x;
+                    shape.cy += t.off_y;
+                }
+                shape.perimeter = boundary;
+                stored = storeBlob(t, b, &shape);
+            } else {
+                stored = storeBlob(t, b, nullptr);
+            }
+            if (t.seeds && stored >= 0) {
+                t.seeds[stored] = (uint32_t)((start_y + t.off_y) * t.seed_stride + start_x + t.off_x);
             }
         }
     }
-}
\ No newline at end of file
+}
@@ -14,7 +14,9 @@
 #pragma once
 
 #include "esp_camera.h"
-#include <vector>
+#include "FixedVector.hpp"
+#include "Morphology.hpp"
+#include "PipelineArena.hpp"
 #include <cstdint>
 
 /// @brief Represents a detected object in the frame.
@@ -26,6 +28,104 @@ struct Blob {
     uint16_t cx;     ///< Centroid X coordinate
     uint16_t cy;     ///< Centroid Y coordinate
     uint32_t area;   ///< Total pixel count
+    uint8_t class_id; ///< Colour class index (0 outside colour segmentation)
+};
+
+/// @brief Colour space a ColorClass range is expressed in.
+enum class ColorSpace : uint8_t {
+    HSV = 0,   ///< H in 0-179 (degrees / 2), S and V in 0-255
+    YUV = 1,   ///< BT.601 full range, U and V centred on 128
+};
+
+/// @brief Inclusive per-channel range selecting one colour class.
+///
+/// For HSV a hue range with min[0] > max[0] wraps through 0 (e.g. red).
+struct ColorClass {
+    ColorSpace space = ColorSpace::HSV;
+    uint8_t min[3] = {0, 0, 0};
+    uint8_t max[3] = {0, 0, 0};
+};
+
+/// @brief One zone of interest in multi-ROI mode (sensor coordinates).
+struct RoiConfig {
+    uint16_t x = 0;                   ///< Start X on the sensor frame
+    uint16_t y = 0;                   ///< Start Y on the sensor frame
+    uint16_t w = 0;                   ///< Width
+    uint16_t h = 0;                   ///< Height
+    uint8_t threshold_val = 100;      ///< Threshold used inside this ROI
+    uint32_t min_blob_area = 10;      ///< Minimum blob size (ROI pixels, after downsampling)
+};
+
+/// @brief Maximum number of ROIs processed per frame.
+constexpr uint8_t kMaxRois = 4;
+
+/// @brief Coarse-level candidates kept per result blob in pyramid mode (noise included).
+constexpr uint8_t kPyramidCandidatesPerBlob = 4;
+
+/// @brief Maximum number of colour classes (one bit each in the class LUT).
+constexpr uint8_t kMaxColorClasses = 8;
+
+/// @brief Optional shape descriptors of a Blob, accumulated during labeling.
+///
+/// Only filled when PipelineConfig::blob_moments / blob_perimeter are set;
+/// entry i describes getBlobs()[i]. Angles are in radians, measured from
+/// +x towards +y in image coordinates (y points down).
+struct BlobShape {
+    float cx;            ///< Sub-pixel centroid X (moments)
+    float cy;            ///< Sub-pixel centroid Y (moments)
+    float mu20;          ///< Central moment / area: variance along X (moments)
+    float mu02;          ///< Central moment / area: variance along Y (moments)
+    float mu11;          ///< Central moment / area: covariance (moments)
+    float orientation;   ///< Major-axis angle in [-pi/2, pi/2] (moments)
+    float eccentricity;  ///< 0 = isotropic, towards 1 = elongated (moments)
+    uint32_t perimeter;  ///< Boundary pixel count, 4-neighbourhood (perimeter)
+};
+
+/// @brief Modelled external-memory traffic for one processed frame.
+///
+/// Counts the bytes each stage reads from / writes to PSRAM (camera
+/// framebuffer and working buffer), assuming every byte touched is
+/// transferred once. Cache-line effects are not modelled.
+struct MemTraffic {
+    size_t psram_read = 0;    ///< Bytes read from PSRAM
+    size_t psram_write = 0;   ///< Bytes written to PSRAM
+};
+
+/// @brief Timed pipeline stages (see CvPipeline::getStageTimeUs()).
+enum class PipelineStage : uint8_t {
+    Grayscale = 0,   ///< Includes the fused strip executor / Sobel stage when enabled
+    Roi,
+    Downsample,
+    Blur,
+    Threshold,
+    Morphology,
+    Blobs,
+    Count
+};
+
+/// @brief Gradient direction bins written when PipelineConfig::edge_direction is set.
+///
+/// Directions are taken modulo 180 degrees in image coordinates (y down).
+enum EdgeDirection : uint8_t {
+    EdgeDir0 = 0,     ///< Gradient along x (vertical edge)
+    EdgeDir45 = 1,    ///< Gradient along +x+y
+    EdgeDir90 = 2,    ///< Gradient along y (horizontal edge)
+    EdgeDir135 = 3,   ///< Gradient along +x-y
+};
+
+/// @brief Binary morphology applied to the thresholded mask.
+enum class MorphOp : uint8_t {
+    None = 0,
+    Erode,
+    Dilate,
+    Open,    ///< Erode then dilate: removes specks smaller than the kernel
+    Close,   ///< Dilate then erode: fills gaps smaller than the kernel
+};
+
+/// @brief What to do when more blobs are found than the result list can hold.
+enum class BlobOverflowPolicy : uint8_t {
+    KeepFirst = 0,    ///< Keep blobs in scan order, drop later ones
+    KeepLargest = 1,  ///< Replace the smallest stored blob if the new one is larger
 };
 
 /// @brief Runtime configuration for the vision pipeline.
@@ -33,10 +133,29 @@ struct PipelineConfig {
     // --- Stage 1: Pre-processing ---
     bool enable_grayscale = true;     ///< Convert RGB565 to Grayscale (Required for most stages)
 
+    // --- Stage 1a: Colour segmentation (replaces grayscale) ---
+    bool enable_color = false;        ///< Classify raw RGB565 pixels into colour classes (configure() fails
+                                      ///< if blur, threshold, morphology, edges or strips are also enabled)
+    uint8_t color_class_count = 0;    ///< Active entries in color_classes
+    ColorClass color_classes[kMaxColorClasses]; ///< Class i sets bit i of the output mask
+
+    // --- Stage 1b: Edges (replaces intensity thresholding) ---
+    bool enable_edges = false;        ///< Sobel gradient magnitude on the ROI at downsample_factor, fused with grayscale
+                                      ///< conversion (not with blur_radius or strip_rows: configure() fails)
+    uint8_t edge_threshold = 32;      ///< Magnitude (|gx| + |gy|) / 8 for an edge pixel (0 = output raw magnitude)
+    bool edge_direction = false;      ///< Also write the quantised gradient direction (EdgeDirection)
+
+    // --- Stage 1c: Denoise ---
+    uint8_t blur_radius = 0;          ///< Box blur radius (0 = off); window is 2r+1 pixels
+    uint8_t blur_passes = 1;          ///< Repeated box passes (3 approximates a Gaussian)
+
     // --- Stage 2: Segmentation ---
     bool enable_threshold = false;    ///< Enable binary thresholding
     uint8_t threshold_val = 100;      ///< 0-255 threshold level
     bool invert = false;              ///< Invert binary mask (true = detect dark objects)
+    MorphOp morph_op = MorphOp::None; ///< Mask clean-up after thresholding
+    uint8_t morph_kernel_w = 3;       ///< Morphology kernel width (1-31)
+    uint8_t morph_kernel_h = 3;       ///< Morphology kernel height (1-31)
 
     // --- Stage 3: ROI & Scaling ---
     bool enable_roi = false;          ///< Enable Region of Interest cropping
@@ -45,18 +164,43 @@ struct PipelineConfig {
     uint16_t roi_w = 0;               ///< ROI width
     uint16_t roi_h = 0;               ///< ROI height
     uint8_t downsample_factor = 1;    ///< 1 = native, 2 = 1/2 size, 4 = 1/4 size
+    uint8_t roi_count = 0;            ///< > 0 selects multi-ROI mode (replaces roi_x/y/w/h)
+    RoiConfig rois[kMaxRois];         ///< Zones sized at configure(), each with its own buffer and blobs
+                                      ///< (configure() fails if a zone leaves max_frame_w/h, roi_count
+                                      ///< exceeds kMaxRois, or enable_roi, blur, morphology, colour, edges,
+                                      ///< strips or shape descriptors are also enabled)
+
+    // --- Execution ---
+    uint16_t strip_rows = 0;          ///< Output rows per internal-SRAM strip (0 = whole-frame stages)
+    uint8_t pyramid_factor = 0;       ///< Coarse-to-fine detection: candidate level at 1/4 or 1/8 scale (0 = off)
+                                      ///< (configure() rejects other values, and colour, edges, multi-ROI,
+                                      ///< strips or a missing threshold / blob stage; with blur or
+                                      ///< morphology the full-resolution path runs instead)
 
     // --- Stage 4: Analysis ---
     bool enable_blob_detection = false; ///< Enable connected component analysis
     uint32_t min_blob_area = 10;        ///< Minimum pixels for a valid blob
+    bool blob_moments = false;          ///< Accumulate 2nd-order moments (centroid, orientation, eccentricity)
+    bool blob_perimeter = false;        ///< Count boundary pixels (labelled pixels are left as 128, not 0)
+
+    // --- Memory Budget (sizes the arena at configure() time) ---
+    uint16_t max_frame_w = 320;         ///< Largest frame width process() will accept
+    uint16_t max_frame_h = 240;         ///< Largest frame height process() will accept
+    uint16_t max_blobs = 32;            ///< Capacity of the blob result list
+    uint16_t label_queue_len = 2048;    ///< Flood-fill queue entries (overflow is handled by rescanning)
+    BlobOverflowPolicy blob_overflow = BlobOverflowPolicy::KeepFirst;
 };
 
 /**
  * @brief Main pipeline class for processing camera frames.
  *
- * This class manages its own working buffer in PSRAM to avoid modifying
+ * This class keeps its working buffer in PSRAM to avoid modifying
  * the original camera framebuffer (zero-copy when possible, but distinct
  * buffers are needed for destructive operations like thresholding).
+ *
+ * All per-frame memory (working buffer, flood-fill queue, blob list) is
+ * carved from a PipelineArena when configure() runs; process() never
+ * touches the heap.
  */
 class CvPipeline {
 public:
@@ -65,9 +209,27 @@ public:
 
     /**
      * @brief Update the pipeline configuration.
+     *
+     * The pipeline sizes and (re)allocates its own arena from the heap.
      * @param config The new configuration settings.
+     * @return false if the arena could not be allocated, or if @p config combines
+     *         stages that cannot run together (the previous configuration is kept).
      */
-    void configure(const PipelineConfig& config);
+    bool configure(const PipelineConfig& config);
+
+    /**
+     * @brief Update the configuration and take all working memory from @p arena.
+     *
+     * The arena is reset and must outlive the pipeline (or the next configure()).
+     * @return false if the arena is smaller than arenaRequirements(config), or if
+     *         @p config is rejected (the arena is then left untouched).
+     */
+    bool configure(const PipelineConfig& config, PipelineArena& arena);
+
+    /**
+     * @brief Arena budget needed to run @p config at its maximum frame size.
+     */
+    static ArenaSizes arenaRequirements(const PipelineConfig& config);
 
     /**
      * @brief Execute the pipeline on a captured frame.
@@ -77,36 +239,184 @@ public:
 
     /**
      * @brief Get the processed binary or grayscale buffer.
-     * @return Pointer to the internal working buffer.
+     *
+     * In colour segmentation mode each byte is the bitmask of matching classes.
+     * In pyramid mode it holds only the last refined window (see getPyramidLevel()).
+     * @return Pointer to the internal working buffer (nullptr in multi-ROI mode, see getRoiOutput()).
      */
     const uint8_t* getOutput() const { return m_out_buffer; }
 
     /**
      * @brief Get the list of blobs detected in the last frame.
-     * @return Vector of detected Blob objects.
+     *
+     * In colour segmentation mode blobs are grouped by Blob::class_id.
+     * @return Fixed-capacity list of detected Blob objects.
+     */
+    const FixedVector<Blob>& getBlobs() const { return m_blobs; }
+
+    /**
+     * @brief Shape descriptors parallel to getBlobs() (empty unless enabled).
      */
-    const std::vector<Blob>& getBlobs() const { return m_blobs; }
+    const FixedVector<BlobShape>& getBlobShapes() const { return m_shapes; }
 
-    // Getters for current effective dimensions
+    /**
+     * @brief Per-pixel EdgeDirection of the last frame (nullptr unless edge_direction is set).
+     *
+     * Same size and layout as getOutput() (ROI at downsample_factor).
+     */
+    const uint8_t* getEdgeDirection() const { return m_edge_dir; }
+
+    /**
+     * @brief Modelled PSRAM traffic of the last processed frame.
+     */
+    const MemTraffic& getMemTraffic() const { return m_traffic; }
+
+    /**
+     * @brief Time spent in @p stage during the last processed frame.
+     */
+    int64_t getStageTimeUs(PipelineStage stage) const { return m_stage_us[(size_t)stage]; }
+
+    /**
+     * @brief Foreground pixels labelled in the last frame (all components, any size).
+     *
+     * A measure of scene load; 0 when blob detection is disabled.
+     */
+    uint32_t getForegroundPixels() const { return m_fg_pixels; }
+
+    /**
+     * @brief Number of blobs discarded in the last frame because the list was full.
+     */
+    uint32_t getDroppedBlobs() const { return m_blobs_dropped; }
+
+    // --- Pyramid mode (pyramid_factor > 1) ---
+
+    /// @brief Thresholded candidate level of the last frame (getPyramidWidth() x getPyramidHeight()).
+    const uint8_t* getPyramidLevel() const { return m_pyr_level; }
+    size_t getPyramidWidth() const { return m_pyr_w; }
+    size_t getPyramidHeight() const { return m_pyr_h; }
+
+    /// @brief Full-resolution windows refined in the last frame (0 when pyramid mode is off).
+    size_t getPyramidWindowCount() const { return m_pyr_window_count; }
+
+    // --- Multi-ROI mode (roi_count > 0) ---
+
+    /// @brief Number of ROIs processed per frame.
+    size_t getRoiCount() const { return m_roi_count; }
+
+    /// @brief Gray or binary output of ROI @p i (getRoiWidth(i) x getRoiHeight(i)).
+    const uint8_t* getRoiOutput(size_t i) const { return m_rois[i].buffer; }
+    size_t getRoiWidth(size_t i) const { return m_rois[i].width; }
+    size_t getRoiHeight(size_t i) const { return m_rois[i].height; }
+
+    /// @brief Blobs of ROI @p i in ROI coordinates (after downsampling).
+    const FixedVector<Blob>& getRoiBlobs(size_t i) const { return m_rois[i].blobs; }
+
+    /// @brief Map a blob of ROI @p i to sensor (full frame) coordinates.
+    Blob roiBlobToSensor(size_t i, const Blob& b) const;
+
+    // Getters for current effective dimensions (0 in multi-ROI mode: there is
+    // no single output, see getRoiWidth() / getRoiHeight())
     size_t getWidth() const { return m_width; }
     size_t getHeight() const { return m_height; }
 
 private:
     PipelineConfig m_config;
 
-    uint8_t* m_out_buffer = nullptr;
+    PipelineArena m_own_arena;          // Used when no external arena is supplied
+    PipelineArena* m_arena = nullptr;
+
+    uint8_t* m_out_buffer = nullptr;    // PSRAM, max_frame_w * max_frame_h
     size_t m_buffer_alloc_size = 0;
 
     // Working dimensions (may change due to ROI/Scaling)
     size_t m_width = 0;
     size_t m_height = 0;
 
-    std::vector<Blob> m_blobs;
+    FixedVector<Blob> m_blobs;          // Internal SRAM, max_blobs entries
+    FixedVector<BlobShape> m_shapes;    // Internal SRAM, max_blobs entries when descriptors are enabled
+    uint32_t m_blobs_dropped = 0;
+    uint32_t m_fg_pixels = 0;
+
+    uint32_t* m_label_queue = nullptr;  // Internal SRAM ring of pixel indices
+    size_t m_label_queue_len = 0;
+
+    uint8_t* m_strip_tile = nullptr;    // Internal SRAM, strip_rows * max_frame_w RGB565 pixels
+    uint8_t* m_blur_line = nullptr;     // Internal SRAM, max(max_frame_w, max_frame_h) pixels
+
+    /// @brief Per-ROI buffers and results (multi-ROI mode).
+    struct RoiState {
+        uint8_t* buffer = nullptr;       // PSRAM, sized for the configured ROI
+        size_t x = 0, y = 0;             // Clamped sensor window of the last frame
+        size_t width = 0, height = 0;    // Output size (after downsampling)
+        FixedVector<Blob> blobs;         // Internal SRAM, max_blobs entries
+    };
+    RoiState m_rois[kMaxRois];
+    size_t m_roi_count = 0;
+    uint8_t* m_roi_line = nullptr;      // Internal SRAM, max_frame_w gray pixels
+
+    /// @brief Full-resolution refinement window (inclusive bounds).
+    struct PyrWindow {
+        uint16_t x0, y0, x1, y1;
+    };
+    uint8_t* m_pyr_level = nullptr;     // PSRAM, coarse level (ceil(max_frame / factor) per axis)
+    size_t m_pyr_w = 0, m_pyr_h = 0;
+    FixedVector<Blob> m_pyr_candidates; // Internal SRAM, kPyramidCandidatesPerBlob * max_blobs
+    PyrWindow* m_pyr_windows = nullptr; // Internal SRAM, one per candidate
+    size_t m_pyr_window_count = 0;
+    uint32_t* m_pyr_seeds = nullptr;    // Internal SRAM, raster index of each result blob's first pixel
+
+    uint8_t* m_color_lut = nullptr;     // Internal SRAM, 65536 class bitmasks indexed by RGB565
+    uint8_t* m_class_mask = nullptr;    // PSRAM, max_frame_w * max_frame_h, one class at a time
+
+    uint8_t* m_sobel_rows = nullptr;    // Internal SRAM, 3 gray rows (rolling window)
+    int16_t* m_sobel_sum = nullptr;     // Internal SRAM, column smoothing (top + 2 mid + bottom)
+    int16_t* m_sobel_diff = nullptr;    // Internal SRAM, column difference (bottom - top)
+    uint8_t* m_edge_dir = nullptr;      // PSRAM, max_frame_w * max_frame_h (edge_direction only)
+    MemTraffic m_traffic;
+
+    uint32_t* m_morph_planes[2] = {nullptr, nullptr}; // Internal SRAM, packed 1-bit masks
+    morph::Workspace m_morph_ws;
+
+    int64_t m_stage_us[(size_t)PipelineStage::Count] = {};
+
+    template <typename F>
+    void timeStage(PipelineStage stage, F&& fn);
+
+    /// @brief One labeling job: a 0/255 mask and where its blobs go.
+    struct LabelTarget {
+        uint8_t* mask;
+        size_t width;
+        size_t height;
+        uint32_t min_area;
+        uint8_t class_id;
+        FixedVector<Blob>* blobs;
+        FixedVector<BlobShape>* shapes;   // nullptr: no descriptors kept
+        uint16_t off_x = 0, off_y = 0;    // Mask origin in result coordinates (windowed labeling)
+        uint32_t* seeds = nullptr;        // Optional: first-pixel raster index per stored blob
+        size_t seed_stride = 0;           // Row length for seeds
+    };
+
+    bool carveArena(PipelineArena& arena);
+    /// @return Index the blob was stored at, or -1 if it was dropped.
+    int storeBlob(const LabelTarget& t, const Blob& b, const BlobShape* shape);
 
     // Internal Stages
+    void runStripExecutor(const camera_fb_t* fb);
+    void runMultiRoi(const camera_fb_t* fb);
+    void runRoiBlobDetection();
+    void runPyramid(const camera_fb_t* fb);
     void convertGrayscale(const camera_fb_t* fb);
+    void buildColorLut();
+    void convertColor(const camera_fb_t* fb);
+    void convertSobel(const camera_fb_t* fb);
+    bool producesMask() const;
     void applyROI();
     void applyDownsample();
+    void applyBlur();
     void applyThreshold();
+    void applyMorphology();
     void runBlobDetection();
+
+    template <bool Moments, bool Perimeter>
+    void labelBlobs(const LabelTarget& t);
 };
\ No newline at end of file
@@ -0,0 +1,56 @@
+/**
+ * @file FixedVector.hpp
+ * @brief Fixed-capacity, non-owning vector for per-frame results.
+ *
+ * Storage is supplied once (typically from a PipelineArena); push_back
+ * never allocates and reports failure when the capacity is reached.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+
+template <typename T>
+class FixedVector {
+public:
+    FixedVector() = default;
+
+    /// @brief Bind to external storage of @p capacity elements and clear.
+    void init(T* storage, size_t capacity) {
+        m_data = storage;
+        m_capacity = storage ? capacity : 0;
+        m_size = 0;
+    }
+
+    /// @return false (and leaves the vector unchanged) when full.
+    bool push_back(const T& value) {
+        if (m_size >= m_capacity) return false;
+        m_data[m_size++] = value;
+        return true;
+    }
+
+    void clear() { m_size = 0; }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+    bool empty() const { return m_size == 0; }
+    bool full() const { return m_size >= m_capacity; }
+
+    T& operator[](size_t i) { return m_data[i]; }
+    const T& operator[](size_t i) const { return m_data[i]; }
+
+    T* begin() { return m_data; }
+    T* end() { return m_data + m_size; }
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_size; }
+    const T* data() const { return m_data; }
+
+private:
+    T* m_data = nullptr;
+    size_t m_capacity = 0;
+    size_t m_size = 0;
+};
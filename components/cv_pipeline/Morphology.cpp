@@ -0,0 +1,248 @@
+/**
+ * @file Morphology.cpp
+ * @brief Implementation of bit-parallel binary morphology.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#include "Morphology.hpp"
+#include <cstring>
+
+namespace morph {
+
+namespace {
+
+// Kernels up to this size use direct shifted combines; larger ones switch
+// to doubling (horizontal) and van Herk/Gil-Werman (vertical).
+constexpr uint8_t kDirectMaxKernel = 3;
+
+/// @brief Mask of the valid bits in the last word of a row.
+inline uint32_t lastWordMask(size_t width) {
+    size_t bits = width % 32;
+    return bits ? ((1u << bits) - 1) : ~0u;
+}
+
+template <bool Erode>
+inline uint32_t combine(uint32_t a, uint32_t b) {
+    return Erode ? (a & b) : (a | b);
+}
+
+template <bool Erode>
+constexpr uint32_t neutral() {
+    return Erode ? ~0u : 0u;
+}
+
+/// @brief out(x) = in(x + s), pixels beyond the row read as @p fill.
+void shiftRow(const uint32_t* in, uint32_t* out, size_t stride, int s, uint32_t fill) {
+    auto word = [&](long k) -> uint32_t {
+        return (k >= 0 && k < (long)stride) ? in[k] : fill;
+    };
+
+    if (s >= 0) {
+        long q = s / 32;
+        int b = s % 32;
+        for (long w = 0; w < (long)stride; w++) {
+            out[w] = b ? (word(w + q) >> b) | (word(w + q + 1) << (32 - b)) : word(w + q);
+        }
+    } else {
+        long q = (-s) / 32;
+        int b = (-s) % 32;
+        for (long w = 0; w < (long)stride; w++) {
+            out[w] = b ? (word(w - q) << b) | (word(w - q - 1) >> (32 - b)) : word(w - q);
+        }
+    }
+}
+
+/// @brief out(x) = combine of in(x), in(x + dir), ... over @p len pixels (doubling).
+template <bool Erode>
+void runCombine(const uint32_t* in, uint32_t* out, uint32_t* tmp, size_t stride, int len, int dir) {
+    const uint32_t fill = neutral<Erode>();
+    memcpy(out, in, stride * sizeof(uint32_t));
+
+    // After each step out(x) covers len_done pixels starting at x.
+    int done = 1;
+    while (done * 2 <= len) {
+        shiftRow(out, tmp, stride, dir * done, fill);
+        for (size_t w = 0; w < stride; w++) out[w] = combine<Erode>(out[w], tmp[w]);
+        done *= 2;
+    }
+    if (done < len) {
+        // Overlapping windows are fine for idempotent AND/OR.
+        shiftRow(out, tmp, stride, dir * (len - done), fill);
+        for (size_t w = 0; w < stride; w++) out[w] = combine<Erode>(out[w], tmp[w]);
+    }
+}
+
+/// @brief One row of the horizontal pass: dst = combine of src(x - r .. x + kw - 1 - r).
+template <bool Erode>
+void horizontalRow(const uint32_t* src, uint32_t* dst, size_t width, size_t stride,
+                   uint8_t kw, uint32_t* scratch) {
+    const uint32_t fill = neutral<Erode>();
+    const uint32_t valid = lastWordMask(width);
+    const int r = kw / 2;
+    uint32_t* a = scratch;
+    uint32_t* b = scratch + stride;
+    uint32_t* c = scratch + 2 * stride;
+
+    // Working copy with the padding bits made neutral
+    memcpy(a, src, stride * sizeof(uint32_t));
+    a[stride - 1] = (a[stride - 1] & valid) | (fill & ~valid);
+
+    if (kw <= 1) {
+        memcpy(dst, a, stride * sizeof(uint32_t));
+    } else if (kw <= kDirectMaxKernel) {
+        shiftRow(a, dst, stride, -r, fill);
+        for (int i = 1; i < kw; i++) {
+            shiftRow(a, b, stride, i - r, fill);
+            for (size_t w = 0; w < stride; w++) dst[w] = combine<Erode>(dst[w], b[w]);
+        }
+    } else {
+        // Right part [x, x + kw - 1 - r] and left part [x - r, x], each by
+        // doubling so the cost is O(log kw) shifts per word. Splitting at x
+        // keeps every shift reading neutral pixels only outside the row.
+        runCombine<Erode>(a, dst, b, stride, kw - r, +1);
+        if (r > 0) {
+            runCombine<Erode>(a, c, b, stride, r + 1, -1);
+            for (size_t w = 0; w < stride; w++) dst[w] = combine<Erode>(dst[w], c[w]);
+        }
+    }
+
+    dst[stride - 1] &= valid;
+}
+
+template <bool Erode>
+void apply(const BitPlane& src, BitPlane& dst, uint8_t kw, uint8_t kh, Workspace& ws) {
+    const size_t H = src.height;
+    const size_t S = src.stride;
+    const uint32_t fill = neutral<Erode>();
+    if (H == 0 || S == 0) return;
+
+    if (kw > kMaxKernel) kw = kMaxKernel;
+    if (kh > kMaxKernel) kh = kMaxKernel;
+    if (kw == 0) kw = 1;
+    if (kh == 0) kh = 1;
+
+    const int r = kh / 2;
+
+    if (kh <= kDirectMaxKernel) {
+        // Horizontal pass into scratch, then direct vertical combine into dst.
+        uint32_t* tmp = ws.vhgw;
+        for (size_t y = 0; y < H; y++) {
+            horizontalRow<Erode>(src.words + y * S, tmp + y * S, src.width, S, kw, ws.row);
+        }
+        for (size_t y = 0; y < H; y++) {
+            uint32_t* out = dst.words + y * dst.stride;
+            for (size_t w = 0; w < S; w++) out[w] = fill;
+            for (int i = -r; i < kh - r; i++) {
+                long yy = (long)y + i;
+                if (yy < 0 || yy >= (long)H) continue; // neutral
+                const uint32_t* in = tmp + yy * S;
+                for (size_t w = 0; w < S; w++) out[w] = combine<Erode>(out[w], in[w]);
+            }
+        }
+        return;
+    }
+
+    // Horizontal pass straight into dst.
+    for (size_t y = 0; y < H; y++) {
+        horizontalRow<Erode>(src.words + y * S, dst.words + y * dst.stride, src.width, S, kw, ws.row);
+    }
+
+    // van Herk/Gil-Werman over virtual rows v = y + r (rows outside the image
+    // are neutral). Output y combines virtual rows [y, y + kh - 1].
+    const size_t N = H + kh - 1;
+    auto rowPtr = [&](size_t v) -> const uint32_t* {
+        long y = (long)v - r;
+        return (y >= 0 && y < (long)H) ? dst.words + y * dst.stride : nullptr;
+    };
+
+    // Suffix combine within each block of kh rows
+    uint32_t* h = ws.vhgw;
+    for (size_t v = N; v-- > 0;) {
+        const uint32_t* in = rowPtr(v);
+        uint32_t* hv = h + v * S;
+        bool block_end = ((v + 1) % kh == 0) || (v == N - 1);
+        for (size_t w = 0; w < S; w++) {
+            uint32_t val = in ? in[w] : fill;
+            hv[w] = block_end ? val : combine<Erode>(val, h[(v + 1) * S + w]);
+        }
+    }
+
+    // Prefix combine streamed forward; output row y = v - kh + 1 is written
+    // after row v has been read, and y <= v - r, so this is safe in place.
+    uint32_t* g = ws.row;
+    for (size_t v = 0; v < N; v++) {
+        const uint32_t* in = rowPtr(v);
+        bool block_start = (v % kh == 0);
+        for (size_t w = 0; w < S; w++) {
+            uint32_t val = in ? in[w] : fill;
+            g[w] = block_start ? val : combine<Erode>(g[w], val);
+        }
+        if (v + 1 >= kh) {
+            size_t y = v + 1 - kh;
+            uint32_t* out = dst.words + y * dst.stride;
+            const uint32_t* hy = h + y * S;
+            for (size_t w = 0; w < S; w++) out[w] = combine<Erode>(hy[w], g[w]);
+        }
+    }
+}
+
+} // namespace
+
+void pack(const uint8_t* mask, BitPlane& out) {
+    for (size_t y = 0; y < out.height; y++) {
+        const uint8_t* src = mask + y * out.width;
+        uint32_t* dst = out.words + y * out.stride;
+        for (size_t w = 0; w < out.stride; w++) {
+            size_t x0 = w * 32;
+            size_t n = (out.width - x0 < 32) ? out.width - x0 : 32;
+            uint32_t bits = 0;
+            size_t i = 0;
+            // 4 pixels per step: gather the MSB of each byte into a nibble.
+            for (; i + 4 <= n; i += 4) {
+                uint32_t v;
+                memcpy(&v, src + x0 + i, 4);
+                bits |= (((v & 0x80808080u) * 0x00204081u) >> 28) << i;
+            }
+            for (; i < n; i++) {
+                bits |= (uint32_t)(src[x0 + i] >> 7) << i;
+            }
+            dst[w] = bits;
+        }
+    }
+}
+
+void unpack(const BitPlane& in, uint8_t* mask) {
+    // Nibble -> four 0/255 bytes (little-endian)
+    static const uint32_t kExpand[16] = {
+        0x00000000, 0x000000FF, 0x0000FF00, 0x0000FFFF,
+        0x00FF0000, 0x00FF00FF, 0x00FFFF00, 0x00FFFFFF,
+        0xFF000000, 0xFF0000FF, 0xFF00FF00, 0xFF00FFFF,
+        0xFFFF0000, 0xFFFF00FF, 0xFFFFFF00, 0xFFFFFFFF,
+    };
+
+    for (size_t y = 0; y < in.height; y++) {
+        const uint32_t* src = in.words + y * in.stride;
+        uint8_t* dst = mask + y * in.width;
+        size_t x = 0;
+        for (; x + 4 <= in.width; x += 4) {
+            uint32_t v = kExpand[(src[x >> 5] >> (x & 31)) & 0xF];
+            memcpy(dst + x, &v, 4);
+        }
+        for (; x < in.width; x++) {
+            dst[x] = ((src[x >> 5] >> (x & 31)) & 1) ? 255 : 0;
+        }
+    }
+}
+
+void erode(const BitPlane& src, BitPlane& dst, uint8_t kw, uint8_t kh, Workspace& ws) {
+    apply<true>(src, dst, kw, kh, ws);
+}
+
+void dilate(const BitPlane& src, BitPlane& dst, uint8_t kw, uint8_t kh, Workspace& ws) {
+    apply<false>(src, dst, kw, kh, ws);
+}
+
+} // namespace morph
@@ -0,0 +1,57 @@
+/**
+ * @file Morphology.hpp
+ * @brief Bit-parallel binary morphology (erode/dilate/open/close).
+ *
+ * Binary masks are packed 32 pixels per word (bit i of word k is pixel
+ * 32*k + i), so one AND/OR processes 32 pixels. Rectangular kernels are
+ * separable into a horizontal pass (word shifts, O(log kw) per word for
+ * large kernels) and a vertical pass (van Herk/Gil-Werman for large
+ * kernels: three word operations per row regardless of kernel height).
+ * Pixels outside the image are neutral, so objects touching the border
+ * are not eroded by it.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace morph {
+
+/// @brief Largest supported kernel extent in either direction.
+constexpr uint8_t kMaxKernel = 31;
+
+/// @brief Words per packed row of @p width pixels.
+inline size_t strideWords(size_t width) { return (width + 31) / 32; }
+
+/// @brief A packed 1-bit image.
+struct BitPlane {
+    uint32_t* words = nullptr;
+    size_t width = 0;
+    size_t height = 0;
+    size_t stride = 0;   ///< Words per row
+};
+
+/// @brief Scratch memory for one morphology pass.
+struct Workspace {
+    uint32_t* vhgw = nullptr;    ///< (height + kMaxKernel) * stride words
+    uint32_t* row = nullptr;     ///< 3 * stride words
+};
+
+/// @brief Pack a 0/255 mask into @p out (out.width/height/stride must be set).
+void pack(const uint8_t* mask, BitPlane& out);
+
+/// @brief Expand @p in back to a 0/255 mask.
+void unpack(const BitPlane& in, uint8_t* mask);
+
+/// @brief dst = src eroded by a kw x kh rectangle (anchored at its centre).
+void erode(const BitPlane& src, BitPlane& dst, uint8_t kw, uint8_t kh, Workspace& ws);
+
+/// @brief dst = src dilated by a kw x kh rectangle (anchored at its centre).
+void dilate(const BitPlane& src, BitPlane& dst, uint8_t kw, uint8_t kh, Workspace& ws);
+
+} // namespace morph
@@ -0,0 +1,133 @@
+/**
+ * @file PipelineArena.hpp
+ * @brief Pre-sized memory arena for the vision pipeline.
+ *
+ * The arena is split into an internal-SRAM region (small, fast: scratch
+ * lines, queues, result storage) and a PSRAM region (large: full-frame
+ * working buffers). Memory is carved out with a bump allocator when the
+ * pipeline is configured and never returned per frame, so the steady state
+ * performs no heap allocations.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#pragma once
+
+#include <esp_heap_caps.h>
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Byte budget for each arena region.
+struct ArenaSizes {
+    size_t internal = 0;   ///< Bytes required in internal SRAM
+    size_t psram = 0;      ///< Bytes required in PSRAM
+};
+
+/// @brief A contiguous block handed out by a bump pointer.
+class ArenaRegion {
+public:
+    void attach(void* base, size_t size) {
+        m_base = static_cast<uint8_t*>(base);
+        m_size = base ? size : 0;
+        m_used = 0;
+    }
+
+    /// @brief Carve @p bytes from the region.
+    /// @return Pointer to the block, or nullptr if the region is exhausted.
+    void* alloc(size_t bytes, size_t align = 4) {
+        if (!m_base) return nullptr;
+        uintptr_t cursor = reinterpret_cast<uintptr_t>(m_base) + m_used;
+        size_t start = ((cursor + align - 1) & ~(uintptr_t)(align - 1)) - reinterpret_cast<uintptr_t>(m_base);
+        if (start + bytes > m_size) return nullptr;
+        m_used = start + bytes;
+        return m_base + start;
+    }
+
+    template <typename T>
+    T* allocArray(size_t count) {
+        return static_cast<T*>(alloc(count * sizeof(T), alignof(T) < 4 ? 4 : alignof(T)));
+    }
+
+    /// @brief Release every block at once (used when the pipeline is reconfigured).
+    void reset() { m_used = 0; }
+
+    size_t size() const { return m_size; }
+    size_t used() const { return m_used; }
+    size_t remaining() const { return m_size - m_used; }
+
+private:
+    uint8_t* m_base = nullptr;
+    size_t m_size = 0;
+    size_t m_used = 0;
+};
+
+/**
+ * @brief Two-region arena (internal SRAM + PSRAM) owned by, or lent to, a pipeline.
+ *
+ * Use allocate() to reserve the memory from the heap once at start-up, or
+ * attach() to hand in statically reserved buffers.
+ */
+class PipelineArena {
+public:
+    PipelineArena() = default;
+    ~PipelineArena() { release(); }
+
+    PipelineArena(const PipelineArena&) = delete;
+    PipelineArena& operator=(const PipelineArena&) = delete;
+
+    /**
+     * @brief Reserve both regions from the heap.
+     *
+     * The PSRAM region falls back to internal RAM on boards without PSRAM.
+     * @return true if both regions were allocated.
+     */
+    bool allocate(const ArenaSizes& sizes) {
+        release();
+        void* internal = sizes.internal
+            ? heap_caps_malloc(sizes.internal, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+            : nullptr;
+        void* psram = sizes.psram ? heap_caps_malloc(sizes.psram, MALLOC_CAP_SPIRAM) : nullptr;
+        if (sizes.psram && !psram) {
+            psram = heap_caps_malloc(sizes.psram, MALLOC_CAP_8BIT);
+        }
+        m_owned_internal = internal;
+        m_owned_psram = psram;
+        m_internal.attach(internal, sizes.internal);
+        m_psram.attach(psram, sizes.psram);
+        return (!sizes.internal || internal) && (!sizes.psram || psram);
+    }
+
+    /// @brief Use caller-owned memory for both regions.
+    void attach(void* internal, size_t internal_size, void* psram, size_t psram_size) {
+        release();
+        m_internal.attach(internal, internal_size);
+        m_psram.attach(psram, psram_size);
+    }
+
+    void release() {
+        if (m_owned_internal) heap_caps_free(m_owned_internal);
+        if (m_owned_psram) heap_caps_free(m_owned_psram);
+        m_owned_internal = nullptr;
+        m_owned_psram = nullptr;
+        m_internal.attach(nullptr, 0);
+        m_psram.attach(nullptr, 0);
+    }
+
+    void reset() {
+        m_internal.reset();
+        m_psram.reset();
+    }
+
+    ArenaSizes capacity() const { return {m_internal.size(), m_psram.size()}; }
+
+    ArenaRegion& internal() { return m_internal; }
+    ArenaRegion& psram() { return m_psram; }
+
+private:
+    ArenaRegion m_internal;
+    ArenaRegion m_psram;
+    void* m_owned_internal = nullptr;
+    void* m_owned_psram = nullptr;
+};
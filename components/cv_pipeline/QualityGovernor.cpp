@@ -0,0 +1,172 @@
+/**
+ * @file QualityGovernor.cpp
+ * @brief Implementation of the deadline-driven quality ladder.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#include "QualityGovernor.hpp"
+#include "Logger.hpp"
+#include <esp_log.h>
+#include <algorithm>
+
+static const char* TAG = "QualityGovernor";
+
+void QualityGovernor::addLevel(const PipelineConfig& config) {
+    if (m_level_count < kMaxQualityLevels) m_levels[m_level_count++] = config;
+}
+
+void QualityGovernor::init(const PipelineConfig& base, const GovernorConfig& config,
+                           uint16_t frame_w, uint16_t frame_h) {
+    m_cfg = config;
+    m_levels[0] = base;
+    m_level_count = 1;
+    m_level = 0;
+    for (auto& b : m_backoff) b = 1;
+    for (auto& l : m_entry_load) l = Load();
+    m_smoothed_us = -1;
+    m_over = m_under = m_since_change = 0;
+    m_last_up = false;
+
+    if (frame_w == 0) frame_w = base.max_frame_w;
+    if (frame_h == 0) frame_h = base.max_frame_h;
+
+    // Each rung starts from the previous one, so quality only goes down the ladder.
+    PipelineConfig c = base;
+
+    // 1. Optional stages: cosmetic clean-up and descriptors nobody needs to meet a deadline
+    if (c.blur_radius > 0 || c.morph_op != MorphOp::None || c.blob_moments ||
+        c.blob_perimeter || c.edge_direction) {
+        c.blur_radius = 0;
+        c.morph_op = MorphOp::None;
+        c.blob_moments = false;
+        c.blob_perimeter = false;
+        c.edge_direction = false;
+        addLevel(c);
+    }
+
+    // 2. Coarser sampling; area limits follow so the same objects still qualify
+    auto halve = [&]() {
+        const size_t f = std::max<size_t>(c.downsample_factor, 1);
+        if (f * 2 > m_cfg.max_downsample) return false;
+        for (size_t i = 0; i < c.roi_count && i < kMaxRois; i++) {
+            if (c.rois[i].w < f * 2 || c.rois[i].h < f * 2) return false;   // zone would vanish
+        }
+        c.downsample_factor = (uint8_t)(f * 2);
+        c.min_blob_area = std::max<uint32_t>(c.min_blob_area / 4, 1);
+        for (auto& r : c.rois) r.min_blob_area = std::max<uint32_t>(r.min_blob_area / 4, 1);
+        return true;
+    };
+
+    // 3. Central 3/4 of the current ROI (single-ROI mode only; zones are fixed)
+    auto shrink = [&]() {
+        if (c.roi_count > 0) return false;
+        uint16_t x = 0, y = 0, w = frame_w, h = frame_h;
+        if (c.enable_roi) {
+            x = std::min(c.roi_x, (uint16_t)(frame_w - 1));
+            y = std::min(c.roi_y, (uint16_t)(frame_h - 1));
+            w = std::min<uint16_t>(c.roi_w, frame_w - x);
+            h = std::min<uint16_t>(c.roi_h, frame_h - y);
+        }
+        const uint16_t nw = w * 3 / 4;
+        const uint16_t nh = h * 3 / 4;
+        if (nw == 0 || nh == 0) return false;
+        c.enable_roi = true;
+        c.roi_x = x + (w - nw) / 2;
+        c.roi_y = y + (h - nh) / 2;
+        c.roi_w = nw;
+        c.roi_h = nh;
+        return true;
+    };
+
+    if (halve()) addLevel(c);
+    if (shrink()) addLevel(c);
+    if (halve()) addLevel(c);
+    if (shrink()) addLevel(c);
+
+    ESP_LOGI(TAG, "Budget %lld us, %u quality levels", (long long)m_cfg.budget_us, m_level_count);
+}
+
+void QualityGovernor::stepTo(uint8_t level, const Load& load) {
+    // Runs on the capture task: deferred so the level change costs no UART time
+    CCM_LOGI(TAG, "Quality level %u -> %u (smoothed %lld us, fg %u permille, %u blobs)",
+             m_level, level, (long long)m_smoothed_us, load.fg_permille, load.blobs);
+    if (level > m_level) m_entry_load[level] = load;
+    m_last_up = level < m_level;
+    m_level = level;
+    m_over = m_under = m_since_change = 0;
+    m_smoothed_us = -1; // The old level's cost says nothing about the new one
+}
+
+void QualityGovernor::restoreLevel(uint8_t level) {
+    if (level >= m_level_count || level == m_level) return;
+    CCM_LOGW(TAG, "Quality level %u rejected by the pipeline, back to %u", m_level, level);
+    m_level = level;
+    m_last_up = false;
+    m_over = m_under = m_since_change = 0;
+    m_smoothed_us = -1;
+}
+
+FrameQuality QualityGovernor::update(const CvPipeline& pipeline, int64_t proc_us) {
+    FrameQuality q;
+    q.level = m_level;
+    q.downsample = std::max<uint8_t>(m_levels[m_level].downsample_factor, 1);
+    q.proc_us = proc_us;
+    q.fg_pixels = pipeline.getForegroundPixels();
+
+    // Scene load, normalised so it compares across downsample levels
+    size_t processed = 0;
+    size_t blobs = 0;
+    if (pipeline.getRoiCount() > 0) {
+        for (size_t i = 0; i < pipeline.getRoiCount(); i++) {
+            processed += pipeline.getRoiWidth(i) * pipeline.getRoiHeight(i);
+            blobs += pipeline.getRoiBlobs(i).size();
+        }
+    } else {
+        processed = pipeline.getWidth() * pipeline.getHeight();
+        blobs = pipeline.getBlobs().size();
+    }
+    Load load;
+    load.fg_permille = processed ? (uint16_t)std::min<uint64_t>((uint64_t)q.fg_pixels * 1000 / processed, 1000) : 0;
+    load.blobs = (uint16_t)std::min<size_t>(blobs, UINT16_MAX);
+    q.fg_permille = load.fg_permille;
+    q.blobs = load.blobs;
+
+    // Smoothed time gates upgrades; single frames drive downgrades
+    m_smoothed_us = m_smoothed_us < 0 ? proc_us
+        : (proc_us * m_cfg.smoothing_pct + m_smoothed_us * (100 - m_cfg.smoothing_pct)) / 100;
+    q.smoothed_us = m_smoothed_us;
+
+    if (m_since_change < UINT16_MAX) m_since_change++;
+    m_over = proc_us > m_cfg.budget_us ? m_over + 1 : 0;
+    m_under = m_smoothed_us * 100 < m_cfg.budget_us * m_cfg.low_watermark_pct ? m_under + 1 : 0;
+
+    // A step up that has held for a full upgrade window clears the penalty
+    if (m_last_up && m_since_change >= m_cfg.upgrade_frames) {
+        m_backoff[m_level + 1] = 1;
+        m_last_up = false;
+    }
+
+    if (m_over >= m_cfg.degrade_frames && m_level + 1 < m_level_count) {
+        // Falling straight back after a step up: wait longer before the next try
+        if (m_last_up) {
+            m_backoff[m_level + 1] = std::min<uint8_t>(m_backoff[m_level + 1] * 2, m_cfg.max_backoff);
+        }
+        stepTo(m_level + 1, load);
+    } else if (m_level > 0 && m_under > 0) {
+        // Budget alone cannot tell a lighter scene from a lucky streak; a clear
+        // drop in load since the level was entered skips the backoff.
+        const Load& entry = m_entry_load[m_level];
+        const bool load_dropped = load.fg_permille < entry.fg_permille &&
+                                  load.fg_permille * 4 <= entry.fg_permille * 3 &&
+                                  load.blobs <= entry.blobs;
+        const uint32_t wait = (uint32_t)m_cfg.upgrade_frames * (load_dropped ? 1 : m_backoff[m_level]);
+        if (m_under >= wait) stepTo(m_level - 1, load);
+    }
+
+    q.next_level = m_level;
+    q.changed = q.next_level != q.level;
+    return q;
+}
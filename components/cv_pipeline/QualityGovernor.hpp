@@ -0,0 +1,117 @@
+/**
+ * @file QualityGovernor.hpp
+ * @brief Deadline-driven quality control for CvPipeline.
+ *
+ * The cost of a frame depends on the scene: a cluttered view produces more
+ * foreground pixels and blobs, so labeling and morphology slow down exactly
+ * when the application can least afford a dropped frame. The governor
+ * watches per-frame processing time together with the scene load and steps
+ * through a precomputed ladder of cheaper configurations (optional stages
+ * off, coarser downsampling, smaller ROI) to hold a per-frame budget, then
+ * climbs back once the load has gone.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#pragma once
+
+#include "CvPipeline.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Number of configurations on the quality ladder (level 0 = base config).
+static constexpr size_t kMaxQualityLevels = 6;
+
+/**
+ * @brief Governor tuning.
+ *
+ * Stepping down is quick (a couple of late frames) and stepping up is slow;
+ * the gap between the budget and the low watermark keeps a level whose cost
+ * sits near the budget from toggling every frame.
+ */
+struct GovernorConfig {
+    int64_t budget_us = 50000;       ///< Per-frame processing budget (1e6 / target FPS)
+    uint8_t low_watermark_pct = 60;  ///< Step up only while the smoothed time is below this share of the budget
+    uint8_t degrade_frames = 2;      ///< Consecutive frames over budget before stepping down
+    uint8_t upgrade_frames = 20;     ///< Consecutive frames under the low watermark before stepping up
+    uint8_t max_backoff = 16;        ///< Cap on the upgrade wait multiplier after failed step-ups
+    uint8_t smoothing_pct = 25;      ///< Weight of the newest frame in the smoothed time
+    uint8_t max_downsample = 8;      ///< Largest downsample_factor the ladder may use
+};
+
+/// @brief Per-frame report, returned alongside the pipeline's results.
+struct FrameQuality {
+    uint8_t level = 0;            ///< Quality level the frame was processed at (0 = full quality)
+    uint8_t next_level = 0;       ///< Level for the next frame
+    bool changed = false;         ///< next_level != level: reconfigure with QualityGovernor::config()
+    uint8_t downsample = 1;       ///< downsample_factor the frame was processed with
+    int64_t proc_us = 0;          ///< Processing time reported for the frame
+    int64_t smoothed_us = 0;      ///< Smoothed processing time
+    uint32_t fg_pixels = 0;       ///< Foreground pixels labelled
+    uint16_t fg_permille = 0;     ///< Foreground share of the processed pixels
+    uint16_t blobs = 0;           ///< Blobs reported (all ROIs / classes)
+};
+
+/**
+ * @brief Chooses the pipeline configuration that meets a processing budget.
+ *
+ * All ladder configurations need no more arena memory than the base one, so
+ * reconfiguring the pipeline on a level change never allocates.
+ */
+class QualityGovernor {
+public:
+    /**
+     * @brief Build the quality ladder from @p base.
+     * @param frame_w,frame_h Size of the frames the pipeline receives, used to
+     *        place a shrunken ROI when @p base has none (0 = max_frame_w/h).
+     */
+    void init(const PipelineConfig& base, const GovernorConfig& config,
+              uint16_t frame_w = 0, uint16_t frame_h = 0);
+
+    /**
+     * @brief Account for one processed frame.
+     * @param pipeline Pipeline that just processed the frame (scene load is read from it).
+     * @param proc_us Time the frame took.
+     */
+    FrameQuality update(const CvPipeline& pipeline, int64_t proc_us);
+
+    /// @brief Configuration for the current level.
+    const PipelineConfig& config() const { return m_levels[m_level]; }
+
+    /**
+     * @brief Return to @p level after the pipeline rejected config().
+     *
+     * Call when CvPipeline::configure() fails for the level update() chose,
+     * then reconfigure with config() again. Counters restart as on a level change.
+     */
+    void restoreLevel(uint8_t level);
+
+    const PipelineConfig& levelConfig(size_t level) const { return m_levels[level]; }
+    uint8_t level() const { return m_level; }
+    uint8_t levelCount() const { return m_level_count; }
+
+private:
+    /// @brief Scene load when a level was entered.
+    struct Load {
+        uint16_t fg_permille = 0;
+        uint16_t blobs = 0;
+    };
+
+    GovernorConfig m_cfg;
+    PipelineConfig m_levels[kMaxQualityLevels];
+    uint8_t m_level_count = 1;
+    uint8_t m_level = 0;
+
+    Load m_entry_load[kMaxQualityLevels];
+    uint8_t m_backoff[kMaxQualityLevels] = {};  // Upgrade wait multiplier per level
+    int64_t m_smoothed_us = -1;
+    uint16_t m_over = 0;          // Consecutive frames over budget
+    uint16_t m_under = 0;         // Consecutive frames under the low watermark
+    uint16_t m_since_change = 0;  // Frames at the current level
+    bool m_last_up = false;       // Last change was a step up
+
+    void addLevel(const PipelineConfig& config);
+    void stepTo(uint8_t level, const Load& load);
+};
@@ -0,0 +1,209 @@
+/**
+ * @file SensorConfig.cpp
+ * @brief Implementation of sensor-side windowing and scaling.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#include "SensorConfig.hpp"
+#include <esp_log.h>
+#include <algorithm>
+
+static const char* TAG = "SensorConfig";
+
+namespace {
+
+/// @brief ROI of @p config clamped to the base frame (same rules as CvPipeline::applyROI).
+struct Rect {
+    size_t x, y, w, h;
+};
+
+Rect effectiveRoi(const PipelineConfig& config, size_t frame_w, size_t frame_h) {
+    Rect r = {0, 0, frame_w, frame_h};
+    if (!config.enable_roi) return r;
+    size_t cx = std::min<size_t>(config.roi_x, frame_w - 1);
+    size_t cy = std::min<size_t>(config.roi_y, frame_h - 1);
+    size_t cw = std::min<size_t>(config.roi_w, frame_w - cx);
+    size_t ch = std::min<size_t>(config.roi_h, frame_h - cy);
+    if (cw > 0 && ch > 0) r = {cx, cy, cw, ch};
+    return r;
+}
+
+const char* offloadName(SensorOffload o) {
+    switch (o) {
+        case SensorOffload::Scale: return "scale";
+        case SensorOffload::WindowScale: return "window+scale";
+        default: return "none";
+    }
+}
+
+} // namespace
+
+esp_err_t SensorConfig::init(sensor_t* sensor, framesize_t base) {
+    if (!sensor || base >= FRAMESIZE_INVALID) return ESP_ERR_INVALID_ARG;
+
+    m_sensor = sensor;
+    m_base = base;
+    m_base_w = resolution[base].width;
+    m_base_h = resolution[base].height;
+    m_caps = SensorCaps();
+
+    // Windowing is only enabled for sensors whose set_res_raw() semantics
+    // are known. OV2640: startX selects the readout mode, offset/total the
+    // window inside it, output the DSP scaler size (multiples of 4).
+    // The window/scaler plans assume RGB565 output; JPEG frames have no
+    // fixed size per pixel and the pipeline cannot read them anyway.
+    const bool rgb565 = sensor->pixformat == PIXFORMAT_RGB565;
+    if (!rgb565) {
+        ESP_LOGW(TAG, "Sensor not in RGB565 (format %d), windowing disabled", (int)sensor->pixformat);
+    }
+    if (sensor->id.PID == OV2640_PID && sensor->set_res_raw && rgb565) {
+        m_caps.windowing = true;
+        m_caps.output_align = 4;
+        if (base <= FRAMESIZE_CIF) {
+            m_caps.window_mode = 2; m_caps.mode_w = 400; m_caps.mode_h = 296;
+        } else if (base <= FRAMESIZE_SVGA) {
+            m_caps.window_mode = 1; m_caps.mode_w = 800; m_caps.mode_h = 600;
+        } else {
+            m_caps.window_mode = 0; m_caps.mode_w = 1600; m_caps.mode_h = 1200;
+        }
+
+        // The base frame is the largest window of its aspect ratio, centred.
+        SensorWindow& bw = m_base_window;
+        if ((uint32_t)m_caps.mode_w * m_base_h > (uint32_t)m_caps.mode_h * m_base_w) {
+            bw.h = m_caps.mode_h;
+            bw.w = (uint32_t)m_caps.mode_h * m_base_w / m_base_h;
+        } else {
+            bw.w = m_caps.mode_w;
+            bw.h = (uint32_t)m_caps.mode_w * m_base_h / m_base_w;
+        }
+        bw.x = (m_caps.mode_w - bw.w) / 2;
+        bw.y = (m_caps.mode_h - bw.h) / 2;
+    }
+
+    ESP_LOGI(TAG, "Sensor PID 0x%04x, base %ux%u, windowing %s",
+             sensor->id.PID, m_base_w, m_base_h, m_caps.windowing ? "yes" : "no");
+    return ESP_OK;
+}
+
+SensorPlan SensorConfig::basePlan(const PipelineConfig& config) const {
+    SensorPlan plan;
+    plan.framesize = m_base;
+    plan.frame_w = m_base_w;
+    plan.frame_h = m_base_h;
+    plan.pipeline = config;
+    return plan;
+}
+
+bool SensorConfig::planWindow(const PipelineConfig& config, SensorPlan& plan) const {
+    if (!m_caps.windowing || m_sensor->pixformat != PIXFORMAT_RGB565) return false;
+
+    const size_t f = std::max<size_t>(config.downsample_factor, 1);
+    const Rect r = effectiveRoi(config, m_base_w, m_base_h);
+    const size_t out_w = r.w / f;
+    const size_t out_h = r.h / f;
+    if (out_w == 0 || out_h == 0) return false;
+    if (out_w % m_caps.output_align || out_h % m_caps.output_align) return false;
+
+    // Base-frame pixels -> readout pixels
+    const SensorWindow& bw = m_base_window;
+    plan.offload = SensorOffload::WindowScale;
+    plan.window.x = bw.x + r.x * bw.w / m_base_w;
+    plan.window.y = bw.y + r.y * bw.h / m_base_h;
+    plan.window.w = r.w * bw.w / m_base_w;
+    plan.window.h = r.h * bw.h / m_base_h;
+    plan.frame_w = out_w;
+    plan.frame_h = out_h;
+
+    // The sensor output is exactly what ROI + downsample would have produced.
+    plan.pipeline.enable_roi = false;
+    plan.pipeline.downsample_factor = 1;
+    return true;
+}
+
+bool SensorConfig::planScale(const PipelineConfig& config, SensorPlan& plan) const {
+    const size_t f = std::max<size_t>(config.downsample_factor, 1);
+    if (f <= 1) return false;
+
+    // Cropping after scaling only matches cropping before it when the ROI
+    // starts on the sampling grid.
+    const Rect r = effectiveRoi(config, m_base_w, m_base_h);
+    if (r.x % f || r.y % f || m_base_w % f || m_base_h % f) return false;
+
+    for (int fs = 0; fs < FRAMESIZE_INVALID; fs++) {
+        if (resolution[fs].width != m_base_w / f || resolution[fs].height != m_base_h / f) continue;
+
+        plan.offload = SensorOffload::Scale;
+        plan.framesize = (framesize_t)fs;
+        plan.frame_w = resolution[fs].width;
+        plan.frame_h = resolution[fs].height;
+        plan.pipeline.downsample_factor = 1;
+        if (config.enable_roi) {
+            plan.pipeline.roi_x = r.x / f;
+            plan.pipeline.roi_y = r.y / f;
+            plan.pipeline.roi_w = r.w / f;
+            plan.pipeline.roi_h = r.h / f;
+        }
+        return true;
+    }
+    return false;
+}
+
+SensorPlan SensorConfig::plan(const PipelineConfig& config) const {
+    SensorPlan plan = basePlan(config);
+    if (!m_sensor || config.roi_count > 0) return plan;
+
+    const bool wants = config.enable_roi || config.downsample_factor > 1;
+    if (!wants) return plan;
+
+    if (planWindow(config, plan)) return plan;
+    plan = basePlan(config);
+    if (planScale(config, plan)) return plan;
+    return basePlan(config);
+}
+
+esp_err_t SensorConfig::program(const SensorPlan& plan) {
+    int rc = -1;
+    switch (plan.offload) {
+        case SensorOffload::WindowScale: {
+            const SensorWindow& w = plan.window;
+            rc = m_sensor->set_res_raw(m_sensor, m_caps.window_mode, 0, 0, 0,
+                                       w.x, w.y, w.w, w.h, plan.frame_w, plan.frame_h,
+                                       false, false);
+            break;
+        }
+        case SensorOffload::Scale:
+        case SensorOffload::None:
+            rc = m_sensor->set_framesize ? m_sensor->set_framesize(m_sensor, plan.framesize) : -1;
+            break;
+    }
+    return rc == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t SensorConfig::apply(const PipelineConfig& config, SensorPlan* out) {
+    if (!m_sensor || !out) return ESP_ERR_INVALID_STATE;
+
+    // Candidates from cheapest to most conservative; the first the sensor accepts wins.
+    SensorPlan candidates[3];
+    size_t count = 0;
+    candidates[count++] = plan(config);
+    if (candidates[0].offload == SensorOffload::WindowScale) {
+        SensorPlan scaled = basePlan(config);
+        if (config.roi_count == 0 && planScale(config, scaled)) candidates[count++] = scaled;
+    }
+    if (candidates[count - 1].offload != SensorOffload::None) candidates[count++] = basePlan(config);
+
+    for (size_t i = 0; i < count; i++) {
+        if (program(candidates[i]) != ESP_OK) {
+            ESP_LOGW(TAG, "Sensor rejected %s offload", offloadName(candidates[i].offload));
+            continue;
+        }
+        *out = candidates[i];
+        ESP_LOGI(TAG, "Offload: %s, sensor delivers %ux%u (%zu bytes/frame)",
+                 offloadName(out->offload), out->frame_w, out->frame_h, out->bytesPerFrame());
+        return ESP_OK;
+    }
+    return ESP_FAIL;
+}
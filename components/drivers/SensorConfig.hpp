@@ -0,0 +1,111 @@
+/**
+ * @file SensorConfig.hpp
+ * @brief Pushes ROI and downsampling into the camera sensor when it can do them.
+ *
+ * Every pixel the pipeline later crops or skips still crosses the DVP bus
+ * and lands in PSRAM. Sensors with a windowing + scaler block can instead
+ * deliver only the ROI at the reduced resolution; most others can at least
+ * switch to a smaller frame size. SensorConfig chooses the cheapest option
+ * the sensor supports, programs it, and returns the PipelineConfig for the
+ * software stages that remain, so blob coordinates are the same whichever
+ * path is taken.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#pragma once
+
+#include "CvPipeline.hpp" // For PipelineConfig struct
+#include <esp_camera.h>
+#include <esp_err.h>
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Which of the ROI / downsample stages the sensor performs.
+enum class SensorOffload : uint8_t {
+    None = 0,      ///< Full base frame; ROI and downsampling stay in software
+    Scale,         ///< Smaller standard frame size; ROI (rescaled) stays in software
+    WindowScale,   ///< Sensor window + scaler deliver exactly the pipeline's input
+};
+
+/// @brief What the attached sensor can do (from its product id).
+struct SensorCaps {
+    bool windowing = false;     ///< Raw window + DSP scaler via set_res_raw()
+    uint8_t window_mode = 0;    ///< Readout mode behind the base frame size (set_res_raw startX)
+    uint16_t mode_w = 0;        ///< Readout resolution of that mode
+    uint16_t mode_h = 0;
+    uint8_t output_align = 1;   ///< Scaler output width/height must be a multiple of this
+};
+
+/// @brief Sensor window in readout-mode pixels (WindowScale only).
+struct SensorWindow {
+    uint16_t x = 0;
+    uint16_t y = 0;
+    uint16_t w = 0;
+    uint16_t h = 0;
+};
+
+/// @brief The chosen split between sensor and software.
+struct SensorPlan {
+    SensorOffload offload = SensorOffload::None;
+    framesize_t framesize = FRAMESIZE_QVGA;  ///< Frame size requested (None / Scale)
+    SensorWindow window;                     ///< Readout window (WindowScale)
+    uint16_t frame_w = 0;                    ///< Size of the frames the sensor will deliver
+    uint16_t frame_h = 0;
+    PipelineConfig pipeline;                 ///< Configuration for the remaining software stages
+
+    /// @brief DVP / framebuffer bytes per RGB565 frame.
+    size_t bytesPerFrame() const { return (size_t)frame_w * frame_h * 2; }
+};
+
+/**
+ * @brief Maps pipeline ROI / downsample settings onto the sensor.
+ *
+ * PipelineConfig coordinates always refer to the base frame size given to
+ * init(). Multi-ROI configurations are never offloaded.
+ */
+class SensorConfig {
+public:
+    /**
+     * @brief Probe the sensor's capabilities.
+     * @param sensor Sensor handle (esp_camera_sensor_get()).
+     * @param base Frame size the pipeline configuration refers to.
+     * Windowing is only enabled while the sensor outputs RGB565.
+     * @return ESP_ERR_INVALID_ARG if @p sensor is null or @p base is invalid.
+     */
+    esp_err_t init(sensor_t* sensor, framesize_t base);
+
+    /**
+     * @brief Choose an offload for @p config without touching the sensor.
+     */
+    SensorPlan plan(const PipelineConfig& config) const;
+
+    /**
+     * @brief Program the sensor for @p config.
+     *
+     * If the sensor rejects the chosen setting, the next cheaper option is
+     * tried, down to the full base frame with everything in software.
+     * @param[out] out Effective plan; configure the pipeline with out->pipeline.
+     * @return ESP_OK, or an error if not even the base frame size could be set.
+     */
+    esp_err_t apply(const PipelineConfig& config, SensorPlan* out);
+
+    const SensorCaps& caps() const { return m_caps; }
+
+private:
+    sensor_t* m_sensor = nullptr;
+    framesize_t m_base = FRAMESIZE_QVGA;
+    uint16_t m_base_w = 0;
+    uint16_t m_base_h = 0;
+    SensorCaps m_caps;
+
+    // Base frame inside the readout mode (aspect-fitted, centred)
+    SensorWindow m_base_window;
+
+    SensorPlan basePlan(const PipelineConfig& config) const;
+    bool planWindow(const PipelineConfig& config, SensorPlan& plan) const;
+    bool planScale(const PipelineConfig& config, SensorPlan& plan) const;
+    esp_err_t program(const SensorPlan& plan);
+};
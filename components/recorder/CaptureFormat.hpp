@@ -0,0 +1,73 @@
+/**
+ * @file CaptureFormat.hpp
+ * @brief On-disk layout of CCM frame capture files (.ccap).
+ *
+ * A capture is written strictly front to back so it can be streamed to an
+ * SD card, flash or a socket:
+ * @code
+ *   CaptureFileHeader
+ *   { CaptureRecordHeader, payload (padded to 4 bytes) } * N
+ *   CaptureIndexEntry * index_count      (optional, written on close)
+ *   CaptureFooter                        (optional, written on close)
+ * @endcode
+ * A file without a footer (power loss, dropped connection) is still
+ * readable: the reader rebuilds the index by walking the record headers.
+ * All fields are little-endian.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace capture {
+
+constexpr uint32_t kFileMagic   = 0x50414343; // "CCAP"
+constexpr uint32_t kRecordSync  = 0x4D524643; // "CFRM"
+constexpr uint32_t kFooterMagic = 0x444E4543; // "CEND"
+constexpr uint16_t kVersion     = 1;
+
+struct CaptureFileHeader {
+    uint32_t magic;          ///< kFileMagic
+    uint16_t version;        ///< kVersion
+    uint16_t header_size;    ///< sizeof(CaptureFileHeader), lets readers skip future fields
+    uint32_t flags;          ///< Reserved, 0
+    uint32_t reserved;
+};
+
+struct CaptureRecordHeader {
+    uint32_t sync;           ///< kRecordSync
+    uint32_t payload_len;    ///< Frame bytes (excluding padding)
+    int64_t timestamp_us;    ///< Capture time (esp_timer clock)
+    uint16_t width;
+    uint16_t height;
+    uint8_t format;          ///< pixformat_t value
+    uint8_t reserved[11];
+};
+
+struct CaptureIndexEntry {
+    uint64_t offset;         ///< File offset of the CaptureRecordHeader
+    int64_t timestamp_us;
+};
+
+struct CaptureFooter {
+    uint64_t index_offset;   ///< File offset of the first CaptureIndexEntry
+    uint32_t frame_count;    ///< Frames written
+    uint32_t index_count;    ///< Index entries written (may be < frame_count)
+    uint32_t reserved;
+    uint32_t magic;          ///< kFooterMagic
+};
+
+static_assert(sizeof(CaptureFileHeader) == 16, "CaptureFileHeader layout");
+static_assert(sizeof(CaptureRecordHeader) == 32, "CaptureRecordHeader layout");
+static_assert(sizeof(CaptureIndexEntry) == 16, "CaptureIndexEntry layout");
+static_assert(sizeof(CaptureFooter) == 24, "CaptureFooter layout");
+
+/// @brief Payloads are padded so every record header stays 4-byte aligned.
+inline size_t paddedPayload(size_t len) { return (len + 3) & ~(size_t)3; }
+
+} // namespace capture
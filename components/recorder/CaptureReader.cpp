@@ -0,0 +1,111 @@
+/**
+ * @file CaptureReader.cpp
+ * @brief Implementation of the .ccap reader.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#include "CaptureReader.hpp"
+#include <esp_log.h>
+#include <algorithm>
+#include <cstring>
+
+static const char* TAG = "CaptureReader";
+
+using namespace capture;
+
+bool CaptureReader::open(const uint8_t* data, size_t len) {
+    m_data = data;
+    m_len = len;
+    m_offsets.clear();
+    m_timestamps.clear();
+    m_recovered = false;
+
+    if (!data || len < sizeof(CaptureFileHeader)) return false;
+
+    CaptureFileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != kFileMagic || header.header_size < sizeof(CaptureFileHeader)) {
+        ESP_LOGE(TAG, "Not a capture file");
+        return false;
+    }
+    if (header.version > kVersion) {
+        ESP_LOGW(TAG, "Capture version %u is newer than reader (v%u)", header.version, kVersion);
+    }
+    m_first_record = header.header_size;
+
+    if (!loadIndex()) {
+        m_recovered = true;
+        scanRecords();
+        ESP_LOGW(TAG, "No complete index, recovered %zu frames by scanning", m_offsets.size());
+    }
+    return true;
+}
+
+bool CaptureReader::record(uint64_t offset, CaptureRecordHeader& out) const {
+    if (offset + sizeof(CaptureRecordHeader) > m_len) return false;
+    // Records are only 4-byte aligned (payload padding): copy, do not cast
+    memcpy(&out, m_data + offset, sizeof(out));
+    if (out.sync != kRecordSync) return false;
+    return offset + sizeof(CaptureRecordHeader) + out.payload_len <= m_len;
+}
+
+bool CaptureReader::loadIndex() {
+    if (m_len < m_first_record + sizeof(CaptureFooter)) return false;
+
+    CaptureFooter footer;
+    memcpy(&footer, m_data + m_len - sizeof(footer), sizeof(footer));
+    if (footer.magic != kFooterMagic || footer.index_count != footer.frame_count) return false;
+
+    uint64_t index_bytes = (uint64_t)footer.index_count * sizeof(CaptureIndexEntry);
+    if (footer.index_offset + index_bytes + sizeof(footer) != m_len) return false;
+
+    const uint8_t* entries = m_data + footer.index_offset;
+    m_offsets.reserve(footer.index_count);
+    m_timestamps.reserve(footer.index_count);
+    for (uint32_t i = 0; i < footer.index_count; i++) {
+        CaptureIndexEntry entry;
+        CaptureRecordHeader rec;
+        memcpy(&entry, entries + (size_t)i * sizeof(entry), sizeof(entry));
+        if (!record(entry.offset, rec)) {
+            m_offsets.clear();
+            m_timestamps.clear();
+            return false;
+        }
+        m_offsets.push_back(entry.offset);
+        m_timestamps.push_back(entry.timestamp_us);
+    }
+    return true;
+}
+
+void CaptureReader::scanRecords() {
+    uint64_t offset = m_first_record;
+    CaptureRecordHeader rec;
+    while (record(offset, rec)) {
+        m_offsets.push_back(offset);
+        m_timestamps.push_back(rec.timestamp_us);
+        offset += sizeof(CaptureRecordHeader) + paddedPayload(rec.payload_len);
+    }
+}
+
+bool CaptureReader::frame(size_t i, CaptureFrame& out) const {
+    if (i >= m_offsets.size()) return false;
+    CaptureRecordHeader rec;
+    if (!record(m_offsets[i], rec)) return false;
+
+    out.fb = {};
+    out.fb.buf = const_cast<uint8_t*>(m_data + m_offsets[i] + sizeof(CaptureRecordHeader));
+    out.fb.len = rec.payload_len;
+    out.fb.width = rec.width;
+    out.fb.height = rec.height;
+    out.fb.format = (pixformat_t)rec.format;
+    out.timestamp_us = rec.timestamp_us;
+    return true;
+}
+
+size_t CaptureReader::seek(int64_t timestamp_us) const {
+    auto it = std::upper_bound(m_timestamps.begin(), m_timestamps.end(), timestamp_us);
+    return it == m_timestamps.begin() ? 0 : (size_t)(it - m_timestamps.begin() - 1);
+}
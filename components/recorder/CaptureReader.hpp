@@ -0,0 +1,60 @@
+/**
+ * @file CaptureReader.hpp
+ * @brief Random-access reader for .ccap frame capture files.
+ *
+ * The reader works on a memory view of the whole file: an mmap()ed file in
+ * the host simulator, or a memory-mapped flash partition on target. Frames
+ * are returned as camera_fb_t views into that memory (no copies).
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#pragma once
+
+#include "CaptureFormat.hpp"
+#include "esp_camera.h"
+#include <vector>
+
+/// @brief One frame of a capture, pointing into the mapped file.
+struct CaptureFrame {
+    camera_fb_t fb;          ///< buf points into the mapping (read-only)
+    int64_t timestamp_us;    ///< Recorded capture time
+};
+
+class CaptureReader {
+public:
+    /**
+     * @brief Attach to a mapped capture.
+     *
+     * Uses the trailing index when it is complete, otherwise walks the
+     * records to rebuild it (truncated recordings stay readable up to the
+     * last complete frame).
+     * @return false if the header is missing or invalid.
+     */
+    bool open(const uint8_t* data, size_t len);
+
+    size_t frameCount() const { return m_offsets.size(); }
+
+    /// @brief True if the index was rebuilt because the footer was missing or partial.
+    bool recovered() const { return m_recovered; }
+
+    /// @brief Fetch frame @p i.
+    bool frame(size_t i, CaptureFrame& out) const;
+
+    /// @brief Index of the last frame recorded at or before @p timestamp_us.
+    size_t seek(int64_t timestamp_us) const;
+
+private:
+    bool loadIndex();
+    void scanRecords();
+    bool record(uint64_t offset, capture::CaptureRecordHeader& out) const;
+
+    const uint8_t* m_data = nullptr;
+    size_t m_len = 0;
+    size_t m_first_record = 0;
+    std::vector<uint64_t> m_offsets;
+    std::vector<int64_t> m_timestamps;
+    bool m_recovered = false;
+};
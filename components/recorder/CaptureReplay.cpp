@@ -0,0 +1,57 @@
+/**
+ * @file CaptureReplay.cpp
+ * @brief Implementation of the capture replay driver.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#include "CaptureReplay.hpp"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+static const char* TAG = "CaptureReplay";
+
+ReplayStats CaptureReplay::run(const CaptureReader& reader, CvPipeline& pipeline, ReplaySpeed speed,
+                               ReplayCallback callback, void* user, size_t first, size_t count) {
+    ReplayStats stats;
+    size_t end = count ? std::min(first + count, reader.frameCount()) : reader.frameCount();
+    if (first >= end) return stats;
+
+    CaptureFrame frame;
+    int64_t start_wall = esp_timer_get_time();
+    int64_t first_ts = 0;
+
+    for (size_t i = first; i < end; i++) {
+        if (!reader.frame(i, frame)) {
+            ESP_LOGW(TAG, "Frame %zu unreadable, stopping", i);
+            break;
+        }
+
+        if (i == first) {
+            first_ts = frame.timestamp_us;
+        } else if (speed == ReplaySpeed::Recorded) {
+            int64_t due = start_wall + (frame.timestamp_us - first_ts);
+            int64_t wait = due - esp_timer_get_time();
+            if (wait > 0) std::this_thread::sleep_for(std::chrono::microseconds(wait));
+        }
+
+        int64_t t0 = esp_timer_get_time();
+        pipeline.process(&frame.fb);
+        int64_t proc = esp_timer_get_time() - t0;
+
+        stats.min_proc_us = stats.frames ? std::min(stats.min_proc_us, proc) : proc;
+        stats.max_proc_us = std::max(stats.max_proc_us, proc);
+        stats.total_proc_us += proc;
+        stats.frames++;
+
+        if (callback) callback(i, frame, pipeline, proc, user);
+    }
+
+    stats.wall_us = esp_timer_get_time() - start_wall;
+    return stats;
+}
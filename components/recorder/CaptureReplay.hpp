@@ -0,0 +1,48 @@
+/**
+ * @file CaptureReplay.hpp
+ * @brief Deterministic replay of a capture through CvPipeline.
+ *
+ * Feeds every frame of a CaptureReader into a pipeline, either paced by
+ * the recorded timestamps (reproduces field timing) or as fast as possible
+ * (benchmark / regression mode), and collects per-frame timing.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#pragma once
+
+#include "CaptureReader.hpp"
+#include "CvPipeline.hpp"
+
+enum class ReplaySpeed : uint8_t {
+    Recorded,   ///< Wait until each frame's recorded offset from the first frame
+    Maximum,    ///< Process back to back
+};
+
+/// @brief Timing summary of a replay run.
+struct ReplayStats {
+    size_t frames = 0;
+    int64_t total_proc_us = 0;
+    int64_t min_proc_us = 0;
+    int64_t max_proc_us = 0;
+    int64_t wall_us = 0;
+
+    float avgProcUs() const { return frames ? (float)total_proc_us / frames : 0.0f; }
+};
+
+/// @brief Called after each frame has been processed.
+using ReplayCallback = void (*)(size_t index, const CaptureFrame& frame,
+                                const CvPipeline& pipeline, int64_t proc_us, void* user);
+
+class CaptureReplay {
+public:
+    /**
+     * @brief Replay frames [first, first + count) of @p reader through @p pipeline.
+     * @param count Number of frames, or 0 for all remaining frames.
+     */
+    static ReplayStats run(const CaptureReader& reader, CvPipeline& pipeline, ReplaySpeed speed,
+                           ReplayCallback callback = nullptr, void* user = nullptr,
+                           size_t first = 0, size_t count = 0);
+};
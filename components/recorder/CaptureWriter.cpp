@@ -0,0 +1,97 @@
+/**
+ * @file CaptureWriter.cpp
+ * @brief Implementation of the streaming .ccap writer.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#include "CaptureWriter.hpp"
+#include <esp_log.h>
+#include <unistd.h>
+#include <cstring>
+
+static const char* TAG = "CaptureWriter";
+
+using namespace capture;
+
+bool FileSink::write(const void* data, size_t len) {
+    return fwrite(data, 1, len, m_file) == len;
+}
+
+bool FdSink::write(const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    while (len > 0) {
+        ssize_t n = ::write(m_fd, p, len);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+CaptureWriter::CaptureWriter(CaptureSink& sink, CaptureIndexEntry* index_storage, size_t index_capacity)
+    : m_sink(sink), m_index(index_storage), m_index_capacity(index_storage ? index_capacity : 0) {}
+
+bool CaptureWriter::put(const void* data, size_t len) {
+    if (m_failed) return false;
+    if (!m_sink.write(data, len)) {
+        ESP_LOGE(TAG, "Sink write failed after %llu bytes", (unsigned long long)m_offset);
+        m_failed = true;
+        return false;
+    }
+    m_offset += len;
+    return true;
+}
+
+bool CaptureWriter::begin() {
+    CaptureFileHeader header = {};
+    header.magic = kFileMagic;
+    header.version = kVersion;
+    header.header_size = sizeof(CaptureFileHeader);
+    return put(&header, sizeof(header));
+}
+
+bool CaptureWriter::writeFrame(const camera_fb_t* fb, int64_t timestamp_us) {
+    if (!fb || m_offset == 0) return false;
+
+    CaptureRecordHeader rec = {};
+    rec.sync = kRecordSync;
+    rec.payload_len = (uint32_t)fb->len;
+    rec.timestamp_us = timestamp_us;
+    rec.width = (uint16_t)fb->width;
+    rec.height = (uint16_t)fb->height;
+    rec.format = (uint8_t)fb->format;
+
+    uint64_t record_offset = m_offset;
+    static const uint8_t kPad[3] = {0, 0, 0};
+    size_t pad = paddedPayload(fb->len) - fb->len;
+
+    if (!put(&rec, sizeof(rec)) || !put(fb->buf, fb->len) || (pad && !put(kPad, pad))) {
+        return false;
+    }
+
+    if (m_index_count < m_index_capacity) {
+        m_index[m_index_count++] = {record_offset, timestamp_us};
+    }
+    m_frame_count++;
+    return true;
+}
+
+bool CaptureWriter::finish() {
+    CaptureFooter footer = {};
+    footer.index_offset = m_offset;
+    footer.frame_count = m_frame_count;
+    footer.index_count = (uint32_t)m_index_count;
+    footer.magic = kFooterMagic;
+
+    if (m_index_count && !put(m_index, m_index_count * sizeof(CaptureIndexEntry))) {
+        return false;
+    }
+    if (!put(&footer, sizeof(footer))) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Capture finished: %u frames, %llu bytes", m_frame_count, (unsigned long long)m_offset);
+    return true;
+}
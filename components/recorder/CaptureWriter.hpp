@@ -0,0 +1,86 @@
+/**
+ * @file CaptureWriter.hpp
+ * @brief Streaming writer for .ccap frame capture files.
+ *
+ * The writer only ever appends, so any byte sink works: a FILE* on the SD
+ * card / SPIFFS VFS, or a socket descriptor for recording over the network.
+ * Index entries are kept in caller-provided storage so recording from the
+ * capture loop does not allocate.
+ *
+ * @author CCM Code (Christie Cahill Meyer)
+ * @date 2025
+ * @copyright MIT License
+ */
+
+#pragma once
+
+#include "CaptureFormat.hpp"
+#include "esp_camera.h"
+#include <cstdio>
+
+/// @brief Destination for capture bytes.
+class CaptureSink {
+public:
+    virtual ~CaptureSink() = default;
+
+    /// @return false if the bytes could not be written (recording stops).
+    virtual bool write(const void* data, size_t len) = 0;
+};
+
+/// @brief Sink writing to a stdio stream (SD card, SPIFFS, host file).
+class FileSink : public CaptureSink {
+public:
+    explicit FileSink(FILE* file) : m_file(file) {}
+    bool write(const void* data, size_t len) override;
+
+private:
+    FILE* m_file;
+};
+
+/// @brief Sink writing to a POSIX descriptor (lwIP socket or VFS file).
+class FdSink : public CaptureSink {
+public:
+    explicit FdSink(int fd) : m_fd(fd) {}
+    bool write(const void* data, size_t len) override;
+
+private:
+    int m_fd;
+};
+
+/**
+ * @brief Appends frames to a capture stream and finishes it with an index.
+ */
+class CaptureWriter {
+public:
+    /**
+     * @param sink Byte destination.
+     * @param index_storage Storage for the seek index (may be nullptr).
+     * @param index_capacity Entries available in @p index_storage. Frames past
+     *        the capacity are still recorded; readers fall back to scanning.
+     */
+    CaptureWriter(CaptureSink& sink, capture::CaptureIndexEntry* index_storage, size_t index_capacity);
+
+    /// @brief Write the file header. Must be called once before writeFrame().
+    bool begin();
+
+    /// @brief Append one frame.
+    bool writeFrame(const camera_fb_t* fb, int64_t timestamp_us);
+
+    /// @brief Append the index and footer. The stream is complete afterwards.
+    bool finish();
+
+    uint32_t frameCount() const { return m_frame_count; }
+    uint64_t bytesWritten() const { return m_offset; }
+    bool failed() const { return m_failed; }
+
+private:
+    bool put(const void* data, size_t len);
+
+    CaptureSink& m_sink;
+    capture::CaptureIndexEntry* m_index;
+    size_t m_index_capacity;
+    size_t m_index_count = 0;
+    uint32_t m_frame_count = 0;
+    uint64_t m_offset = 0;
+    bool m_failed = false;
+};
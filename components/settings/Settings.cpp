@@ -11,33 +11,180 @@
 #include <nvs_flash.h>
 #include <nvs.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <cstddef>
 #include <cstring>
+#include <algorithm>
+#include <memory>
+#include <new>
+
+#ifdef ESP_PLATFORM
+#include <esp_pthread.h>
+#endif
 
 static const char* TAG = "Settings";
 
+namespace {
+
+constexpr uint16_t kRecordMagic = 0x4343; // "CC"
+constexpr size_t kHeaderSize = 4;         // magic(2) + schema(1) + count(1)
+constexpr size_t kEntryHeaderSize = 2;    // tag(1) + len(1)
+
+/// @brief Maps a stable on-flash tag to a PipelineConfig member.
+struct FieldDesc {
+    uint8_t tag;
+    uint8_t size;
+    size_t offset;
+};
+
+#define CFG_FIELD(tag, member) \
+    { tag, sizeof(PipelineConfig::member), offsetof(PipelineConfig, member) }
+
+// Tags are permanent: never renumber or reuse one, only append.
+// Payloads are the member's native little-endian representation.
+const FieldDesc kFields[] = {
+    CFG_FIELD(1,  enable_grayscale),
+    CFG_FIELD(2,  enable_threshold),
+    CFG_FIELD(3,  threshold_val),
+    CFG_FIELD(4,  invert),
+    CFG_FIELD(5,  enable_roi),
+    CFG_FIELD(6,  roi_x),
+    CFG_FIELD(7,  roi_y),
+    CFG_FIELD(8,  roi_w),
+    CFG_FIELD(9,  roi_h),
+    CFG_FIELD(10, downsample_factor),
+    CFG_FIELD(11, enable_blob_detection),
+    CFG_FIELD(12, min_blob_area),
+    CFG_FIELD(13, max_frame_w),
+    CFG_FIELD(14, max_frame_h),
+    CFG_FIELD(15, max_blobs),
+    CFG_FIELD(16, label_queue_len),
+    CFG_FIELD(17, blob_overflow),
+    CFG_FIELD(18, strip_rows),
+    CFG_FIELD(19, morph_op),
+    CFG_FIELD(20, morph_kernel_w),
+    CFG_FIELD(21, morph_kernel_h),
+    CFG_FIELD(22, blob_moments),
+    CFG_FIELD(23, blob_perimeter),
+    CFG_FIELD(24, blur_radius),
+    CFG_FIELD(25, blur_passes),
+    CFG_FIELD(26, enable_edges),
+    CFG_FIELD(27, edge_threshold),
+    CFG_FIELD(28, edge_direction),
+    CFG_FIELD(29, enable_color),
+    CFG_FIELD(30, color_class_count),
+    // 31: reserved (never released)
+    CFG_FIELD(32, roi_count),
+    // 33: reserved (never released)
+    CFG_FIELD(34, pyramid_factor),
+};
+
+/// @brief Maps a stable tag to one member of every element of a PipelineConfig array.
+///
+/// One entry is written per element; its payload is [index u8][member bytes],
+/// so each member is versioned like a scalar field and struct padding never
+/// reaches flash.
+struct ElementDesc {
+    uint8_t tag;
+    uint8_t size;           // Member size (payload is size + 1)
+    size_t array_offset;    // Array within PipelineConfig
+    size_t stride;          // sizeof(element)
+    uint8_t count;          // Array length
+    size_t member_offset;   // Member within the element
+};
+
+#define CFG_ELEMENT(tag, array, type, member)                                     \
+    { tag, sizeof(type::member), offsetof(PipelineConfig, array), sizeof(type),   \
+      (uint8_t)(sizeof(PipelineConfig::array) / sizeof(type)), offsetof(type, member) }
+
+const ElementDesc kElements[] = {
+    CFG_ELEMENT(35, color_classes, ColorClass, space),
+    CFG_ELEMENT(36, color_classes, ColorClass, min),
+    CFG_ELEMENT(37, color_classes, ColorClass, max),
+    CFG_ELEMENT(38, rois, RoiConfig, x),
+    CFG_ELEMENT(39, rois, RoiConfig, y),
+    CFG_ELEMENT(40, rois, RoiConfig, w),
+    CFG_ELEMENT(41, rois, RoiConfig, h),
+    CFG_ELEMENT(42, rois, RoiConfig, threshold_val),
+    CFG_ELEMENT(43, rois, RoiConfig, min_blob_area),
+};
+
+#undef CFG_ELEMENT
+
+#undef CFG_FIELD
+
+/// @brief Layout of PipelineConfig as written raw by firmware v0.2.1 and earlier.
+struct LegacyConfigV0 {
+    bool enable_grayscale;
+    bool enable_threshold;
+    uint8_t threshold_val;
+    bool invert;
+    bool enable_roi;
+    uint16_t roi_x;
+    uint16_t roi_y;
+    uint16_t roi_w;
+    uint16_t roi_h;
+    uint8_t downsample_factor;
+    bool enable_blob_detection;
+    uint32_t min_blob_area;
+};
+
+const FieldDesc* findField(uint8_t tag) {
+    for (const auto& f : kFields) {
+        if (f.tag == tag) return &f;
+    }
+    return nullptr;
+}
+
+const ElementDesc* findElement(uint8_t tag) {
+    for (const auto& e : kElements) {
+        if (e.tag == tag) return &e;
+    }
+    return nullptr;
+}
+
+/// @brief Upgrade a decoded config from schema @p from to @p from + 1.
+void migrateStep(uint8_t from, PipelineConfig& config) {
+    switch (from) {
+        // Add a case here whenever kSchemaVersion is bumped, e.g.
+        //   case 1: config.threshold_val = 255 - config.threshold_val; break;
+        default:
+            (void)config;
+            break;
+    }
+}
+
+} // namespace
+
 Settings& Settings::get() {
     static Settings instance;
     return instance;
 }
 
+Settings::~Settings() {
+    shutdown();
+}
+
 void Settings::resetDefaults() {
     // Define "Safe Factory Defaults"
+    // Fields not listed here keep their PipelineConfig initializers.
+    m_config = PipelineConfig();
     m_config.enable_grayscale = true;
     m_config.enable_threshold = false;
     m_config.threshold_val = 128;
     m_config.invert = false;
-    
+
     m_config.enable_roi = false;
     m_config.roi_x = 0;
     m_config.roi_y = 0;
     m_config.roi_w = 320; // Default to QVGA width
     m_config.roi_h = 240; // Default to QVGA height
-    
+
     m_config.downsample_factor = 1;
-    
+
     m_config.enable_blob_detection = false;
     m_config.min_blob_area = 10;
-    
+
     ESP_LOGI(TAG, "Settings reset to defaults");
 }
 
@@ -56,51 +203,292 @@ esp_err_t Settings::init() {
     }
 
     // 2. Load existing values
-    return load();
+    err = load();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // 3. Start the background writer (low priority, off the capture path)
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_writer.joinable()) {
+#ifdef ESP_PLATFORM
+        esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+        cfg.stack_size = 4096;
+        cfg.prio = 1;
+        cfg.thread_name = "settings_wr";
+        esp_pthread_set_cfg(&cfg);
+#endif
+        m_stop = false;
+        m_writer = std::thread(&Settings::writerLoop, this);
+    }
+    return ESP_OK;
 }
 
 esp_err_t Settings::load() {
     nvs_handle_t handle;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
-    
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // Read tagged record. Newer firmware may write more than kMaxRecordSize,
+    // so the buffer is sized from the stored blob (boot-time only).
+    size_t record_size = 0;
+    err = nvs_get_blob(handle, NVS_KEY, nullptr, &record_size);
+    std::unique_ptr<uint8_t[]> record;
+    if (err == ESP_OK) {
+        record.reset(new (std::nothrow) uint8_t[std::max<size_t>(record_size, 1)]);
+        if (!record) {
+            ESP_LOGE(TAG, "No memory for the %zu-byte config record, using defaults", record_size);
+            nvs_close(handle);
+            resetDefaults();
+            return ESP_ERR_NO_MEM;
+        }
+        err = nvs_get_blob(handle, NVS_KEY, record.get(), &record_size);
+    }
+
+    if (err == ESP_OK) {
+        resetDefaults();
+        err = decode(record.get(), record_size, m_config);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Config record invalid (%s), using defaults", esp_err_to_name(err));
+            resetDefaults();
+        } else {
+            ESP_LOGI(TAG, "Config loaded from NVS");
+        }
+        nvs_close(handle);
+        return ESP_OK;
+    }
+
     if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = migrateLegacy(handle);
+        nvs_close(handle);
+        if (err == ESP_OK) {
+            return ESP_OK;
+        }
         ESP_LOGW(TAG, "No config found in NVS, using defaults.");
         resetDefaults();
-        return save(); // Save defaults so NVS is initialized next time
+        return writeToNvs(m_config); // Save defaults so NVS is initialized next time
     }
-    else if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+
+    ESP_LOGE(TAG, "Failed to read config record: %s", esp_err_to_name(err));
+    nvs_close(handle);
+    resetDefaults();
+    return ESP_OK;
+}
+
+esp_err_t Settings::migrateLegacy(nvs_handle_t handle) {
+    size_t size = 0;
+    esp_err_t err = nvs_get_blob(handle, NVS_LEGACY_KEY, nullptr, &size);
+    if (err != ESP_OK) {
         return err;
     }
 
-    // Read Blob
-    size_t required_size = sizeof(PipelineConfig);
-    err = nvs_get_blob(handle, NVS_KEY, &m_config, &required_size);
-    
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to read config blob: %s", esp_err_to_name(err));
-        resetDefaults();
+    resetDefaults();
+    if (size == sizeof(LegacyConfigV0)) {
+        LegacyConfigV0 old;
+        err = nvs_get_blob(handle, NVS_LEGACY_KEY, &old, &size);
+        if (err != ESP_OK) {
+            return err;
+        }
+        m_config.enable_grayscale = old.enable_grayscale;
+        m_config.enable_threshold = old.enable_threshold;
+        m_config.threshold_val = old.threshold_val;
+        m_config.invert = old.invert;
+        m_config.enable_roi = old.enable_roi;
+        m_config.roi_x = old.roi_x;
+        m_config.roi_y = old.roi_y;
+        m_config.roi_w = old.roi_w;
+        m_config.roi_h = old.roi_h;
+        m_config.downsample_factor = old.downsample_factor;
+        m_config.enable_blob_detection = old.enable_blob_detection;
+        m_config.min_blob_area = old.min_blob_area;
+        ESP_LOGI(TAG, "Migrated legacy config blob to schema v%u", kSchemaVersion);
     } else {
-        ESP_LOGI(TAG, "Config loaded from NVS");
+        ESP_LOGW(TAG, "Legacy config blob has unexpected size %zu, using defaults", size);
     }
 
-    nvs_close(handle);
+    err = writeToNvs(m_config);
+    if (err == ESP_OK) {
+        nvs_erase_key(handle, NVS_LEGACY_KEY);
+        err = nvs_commit(handle);
+    }
     return err;
 }
 
-esp_err_t Settings::save() {
+size_t Settings::encode(const PipelineConfig& config, uint8_t* out, size_t capacity) {
+    size_t count = sizeof(kFields) / sizeof(kFields[0]);
+    for (const auto& e : kElements) count += e.count;
+    if (capacity < kHeaderSize || count > UINT8_MAX) return 0;
+
+    out[0] = kRecordMagic & 0xFF;
+    out[1] = kRecordMagic >> 8;
+    out[2] = kSchemaVersion;
+    out[3] = (uint8_t)count;
+
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(&config);
+    size_t pos = kHeaderSize;
+    for (const auto& f : kFields) {
+        if (pos + kEntryHeaderSize + f.size > capacity) return 0;
+        out[pos++] = f.tag;
+        out[pos++] = f.size;
+        memcpy(out + pos, base + f.offset, f.size);
+        pos += f.size;
+    }
+    for (const auto& e : kElements) {
+        for (uint8_t i = 0; i < e.count; i++) {
+            if (pos + kEntryHeaderSize + 1 + e.size > capacity) return 0;
+            out[pos++] = e.tag;
+            out[pos++] = e.size + 1;
+            out[pos++] = i;
+            memcpy(out + pos, base + e.array_offset + i * e.stride + e.member_offset, e.size);
+            pos += e.size;
+        }
+    }
+    return pos;
+}
+
+esp_err_t Settings::decode(const uint8_t* data, size_t len, PipelineConfig& config) {
+    if (len < kHeaderSize) return ESP_ERR_INVALID_SIZE;
+
+    uint16_t magic = data[0] | (data[1] << 8);
+    if (magic != kRecordMagic) return ESP_ERR_INVALID_VERSION;
+
+    uint8_t schema = data[2];
+    uint8_t count = data[3];
+    if (schema > kSchemaVersion) {
+        ESP_LOGW(TAG, "Config written by newer schema v%u (have v%u), ignoring unknown fields",
+                 schema, kSchemaVersion);
+    }
+
+    uint8_t* base = reinterpret_cast<uint8_t*>(&config);
+    size_t pos = kHeaderSize;
+    for (uint8_t i = 0; i < count; i++) {
+        if (pos + kEntryHeaderSize > len) return ESP_ERR_INVALID_SIZE;
+        uint8_t tag = data[pos++];
+        uint8_t size = data[pos++];
+        if (pos + size > len) return ESP_ERR_INVALID_SIZE;
+
+        // Unknown tags, or known tags whose width changed, are skipped.
+        const FieldDesc* f = findField(tag);
+        const ElementDesc* e = f ? nullptr : findElement(tag);
+        if (f && f->size == size) {
+            memcpy(base + f->offset, data + pos, size);
+        } else if (e && e->size + 1 == size && data[pos] < e->count) {
+            memcpy(base + e->array_offset + data[pos] * e->stride + e->member_offset, data + pos + 1, e->size);
+        }
+        pos += size;
+    }
+
+    for (uint8_t v = schema; v < kSchemaVersion; v++) {
+        migrateStep(v, config);
+    }
+    return ESP_OK;
+}
+
+esp_err_t Settings::writeToNvs(const PipelineConfig& config) {
+    uint8_t record[kMaxRecordSize];
+    size_t len = encode(config, record, sizeof(record));
+    if (len == 0) {
+        ESP_LOGE(TAG, "Config record exceeds %zu bytes", kMaxRecordSize);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    std::lock_guard<std::mutex> nvs_lock(m_nvs_mutex);
+    int64_t start = esp_timer_get_time();
+
     nvs_handle_t handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
     if (err != ESP_OK) return err;
 
-    err = nvs_set_blob(handle, NVS_KEY, &m_config, sizeof(PipelineConfig));
+    err = nvs_set_blob(handle, NVS_KEY, record, len);
     if (err == ESP_OK) {
         err = nvs_commit(handle);
-        ESP_LOGI(TAG, "Config saved to NVS");
+        ESP_LOGI(TAG, "Config saved to NVS (%zu bytes)", len);
     } else {
         ESP_LOGE(TAG, "Failed to write config blob");
     }
-
     nvs_close(handle);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.commits++;
+    m_stats.last_commit_us = esp_timer_get_time() - start;
     return err;
-}
\ No newline at end of file
+}
+
+esp_err_t Settings::save() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stats.save_requests++;
+
+    if (!m_writer.joinable()) {
+        lock.unlock();
+        return writeToNvs(m_config);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (!m_dirty) {
+        m_first_change = now;
+    }
+    m_last_change = now;
+    m_pending = m_config;
+    m_dirty = true;
+    m_cv.notify_one();
+    return ESP_OK;
+}
+
+esp_err_t Settings::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_dirty) return ESP_OK;
+
+    PipelineConfig snapshot = m_pending;
+    m_dirty = false;
+    lock.unlock();
+    return writeToNvs(snapshot);
+}
+
+void Settings::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_writer.joinable()) return;
+        m_stop = true;
+        m_cv.notify_one();
+    }
+    m_writer.join();
+}
+
+void Settings::setDebounce(uint32_t debounce_ms, uint32_t max_delay_ms) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_debounce_ms = debounce_ms;
+    m_max_delay_ms = std::max(debounce_ms, max_delay_ms);
+    m_cv.notify_one();
+}
+
+SettingsStats Settings::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void Settings::writerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this] { return m_dirty || m_stop; });
+        if (!m_dirty) break; // stop requested with nothing pending
+
+        // Debounce: wait until the config has been quiet for m_debounce_ms,
+        // but never longer than m_max_delay_ms after the first change.
+        while (m_dirty && !m_stop) {
+            auto deadline = std::min(m_last_change + std::chrono::milliseconds(m_debounce_ms),
+                                     m_first_change + std::chrono::milliseconds(m_max_delay_ms));
+            if (std::chrono::steady_clock::now() >= deadline) break;
+            m_cv.wait_until(lock, deadline);
+        }
+        if (!m_dirty) continue; // flush() got there first
+
+        PipelineConfig snapshot = m_pending;
+        m_dirty = false;
+        lock.unlock();
+        writeToNvs(snapshot);
+        lock.lock();
+    }
+}
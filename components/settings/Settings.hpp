@@ -3,6 +3,10 @@
  * @brief Persistent configuration manager using NVS.
  *
  * Handles loading and saving of application settings to flash memory.
+ * Settings are stored as a versioned, tagged record so that adding a
+ * PipelineConfig field does not wipe the configuration of deployed nodes,
+ * and writes are coalesced by a background task so no caller blocks on
+ * a flash commit.
  *
  * @author CCM Code (Christie Cahill Meyer)
  * @date 2025
@@ -13,34 +17,86 @@
 
 #include "CvPipeline.hpp" // For PipelineConfig struct
 #include <esp_err.h>
+#include <nvs.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/// @brief Counters describing the persistence behaviour (for diagnostics/simulation).
+struct SettingsStats {
+    uint32_t save_requests = 0;   ///< Number of save() calls
+    uint32_t commits = 0;         ///< Number of NVS commits actually performed
+    int64_t last_commit_us = 0;   ///< Duration of the most recent write + commit
+};
 
 /**
  * @brief Singleton manager for persistent application settings.
+ *
+ * On-flash layout (key "cfg"), little-endian:
+ * @code
+ *   [magic u16][schema u8][count u8] { [tag u8][len u8][payload len bytes] } * count
+ * @endcode
+ * Members of array elements (colour classes, ROIs) have one tag per member;
+ * each element is a separate entry whose payload starts with its index.
+ * Unknown tags are skipped (a newer firmware's record loads on older firmware)
+ * and missing tags keep their defaults (an older record loads on newer firmware).
+ * Tags are never reused; bump kSchemaVersion and add a migration step only when
+ * the meaning of an existing tag changes.
  */
 class Settings {
 public:
+    static constexpr uint8_t kSchemaVersion = 1;
+    static constexpr size_t kMaxRecordSize = 512;   ///< Largest record this firmware writes (load() reads any size)
+
     /**
      * @brief Get the singleton instance.
      */
     static Settings& get();
 
     /**
-     * @brief Initialize NVS and load settings.
+     * @brief Initialize NVS, load settings and start the background writer.
      * @return ESP_OK on success.
      */
     esp_err_t init();
 
     /**
      * @brief Load settings from NVS.
-     * Populates the internal config object with defaults if NVS is empty.
+     * Populates the internal config object with defaults if NVS is empty and
+     * migrates records written by older firmware (including the legacy raw blob).
+     * @return ESP_ERR_NO_MEM if the stored record is too large to buffer.
      */
     esp_err_t load();
 
     /**
-     * @brief Save current settings to NVS.
+     * @brief Request that the current settings be persisted.
+     *
+     * Snapshots the configuration and returns immediately. The background
+     * writer commits once no further save() has arrived for the debounce window
+     * (or the maximum delay has elapsed), so bursts of changes cost one commit.
+     * Before init() has started the writer, the write is performed synchronously.
      */
     esp_err_t save();
 
+    /**
+     * @brief Synchronously write any pending snapshot to NVS.
+     */
+    esp_err_t flush();
+
+    /**
+     * @brief Flush pending changes and stop the background writer.
+     */
+    void shutdown();
+
+    /**
+     * @brief Configure the coalescing window.
+     * @param debounce_ms Quiet time required after the last save() before committing.
+     * @param max_delay_ms Upper bound from the first pending save() to its commit.
+     */
+    void setDebounce(uint32_t debounce_ms, uint32_t max_delay_ms);
+
     /**
      * @brief Access the current configuration (Read-Only).
      */
@@ -57,10 +113,52 @@ public:
      */
     void resetDefaults();
 
+    /**
+     * @brief Persistence counters (save requests, commits, commit latency).
+     */
+    SettingsStats stats() const;
+
+    /**
+     * @brief Serialize a configuration into the tagged record format.
+     * @return Number of bytes written, or 0 if @p capacity is too small.
+     */
+    static size_t encode(const PipelineConfig& config, uint8_t* out, size_t capacity);
+
+    /**
+     * @brief Parse a tagged record on top of @p config.
+     *
+     * Fields not present in the record are left untouched, so callers should
+     * pass in a defaulted config. Records from older schemas are migrated.
+     */
+    static esp_err_t decode(const uint8_t* data, size_t len, PipelineConfig& config);
+
 private:
     Settings() = default; // Private constructor (Singleton)
-    
+    ~Settings();
+
+    esp_err_t writeToNvs(const PipelineConfig& config);
+    esp_err_t migrateLegacy(nvs_handle_t handle);
+    void writerLoop();
+
     PipelineConfig m_config;
+
+    // Background writer state (guarded by m_mutex)
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_writer;
+    PipelineConfig m_pending;
+    bool m_dirty = false;
+    bool m_stop = false;
+    std::chrono::steady_clock::time_point m_first_change;
+    std::chrono::steady_clock::time_point m_last_change;
+    uint32_t m_debounce_ms = 500;
+    uint32_t m_max_delay_ms = 5000;
+    SettingsStats m_stats;
+
+    // Serializes NVS access between flush() and the writer task
+    std::mutex m_nvs_mutex;
+
     const char* NVS_NAMESPACE = "ccm_cfg";
-    const char* NVS_KEY = "pipe_cfg";
-};
\ No newline at end of file
+    const char* NVS_KEY = "cfg";
+    const char* NVS_LEGACY_KEY = "pipe_cfg"; // v0: raw sizeof(PipelineConfig) blob
+};
@@ -0,0 +1,376 @@
+#include "Logger.hpp"
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#ifdef ESP_PLATFORM
+#include <esp_pthread.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+static const char* TAG = "Logger";
+
+namespace Logger {
+namespace detail {
+
+std::atomic<uint8_t> g_max_level{(uint8_t)Level::Info};
+
+} // namespace detail
+
+namespace {
+
+using detail::ArgType;
+using detail::Entry;
+using detail::Ring;
+
+Ring g_rings[detail::kMaxCores];
+std::atomic<bool> g_ready{false};
+std::atomic<uint32_t> g_writers{0};   // Producers between acquire() and commit()
+std::atomic<uint32_t> g_written{0};
+std::atomic<uint32_t> g_dropped{0};
+
+// Consumer side (log task or flush()); never touched by producers.
+std::mutex g_consumer_mutex;
+uint32_t g_emitted = 0;
+uint32_t g_dropped_reported = 0;
+Sink g_sink = nullptr;
+
+// Log task
+std::mutex g_task_mutex;
+std::condition_variable g_task_cv;
+std::thread g_task;
+bool g_stop = false;
+uint32_t g_interval_ms = 20;
+
+// Entry used while the rings are not allocated
+thread_local Entry t_unbuffered;
+
+size_t currentCore() {
+#ifdef ESP_PLATFORM
+    return (size_t)xPortGetCoreID() % detail::kMaxCores;
+#else
+    // Host: spread threads over the rings like tasks pinned to two cores.
+    static std::atomic<size_t> next{0};
+    thread_local size_t core = next.fetch_add(1, std::memory_order_relaxed) % detail::kMaxCores;
+    return core;
+#endif
+}
+
+void defaultSink(Level level, const char* tag, const char* line) {
+    switch (level) {
+        case Level::Error: ESP_LOGE(tag, "%s", line); break;
+        case Level::Warn:  ESP_LOGW(tag, "%s", line); break;
+        case Level::Info:  ESP_LOGI(tag, "%s", line); break;
+        default:           ESP_LOGD(tag, "%s", line); break;
+    }
+}
+
+uint64_t argBits(const Entry& e, size_t& word, ArgType type) {
+    uint64_t b = e.words[word++];
+    if (type == ArgType::I64 || type == ArgType::U64 || type == ArgType::F64 ||
+        ((type == ArgType::Str || type == ArgType::Ptr) && sizeof(void*) > 4)) {
+        b |= (uint64_t)e.words[word++] << 32;
+    }
+    return b;
+}
+
+int64_t asInt(ArgType type, uint64_t b) {
+    switch (type) {
+        case ArgType::I32: return (int32_t)(uint32_t)b;
+        case ArgType::F64: { double d; memcpy(&d, &b, sizeof(d)); return (int64_t)d; }
+        default: return (int64_t)b;
+    }
+}
+
+double asDouble(ArgType type, uint64_t b) {
+    switch (type) {
+        case ArgType::F64: { double d; memcpy(&d, &b, sizeof(d)); return d; }
+        case ArgType::I32: return (int32_t)(uint32_t)b;
+        case ArgType::I64: return (int64_t)b;
+        default: return (double)b;
+    }
+}
+
+/// @brief printf the stored arguments, one conversion at a time.
+///
+/// Length modifiers in the format are replaced by the width the argument was
+/// stored with, so "%u" with a size_t or "%ld" with an int32_t print correctly
+/// on either target.
+void formatEntry(const Entry& e, char* out, size_t len) {
+    const char* f = e.site->fmt;
+    size_t n = 0, word = 0, arg = 0;
+    auto room = [&]() { return n < len ? len - n : 0; };
+
+    while (*f && n + 1 < len) {
+        if (*f != '%') {
+            out[n++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            out[n++] = '%';
+            f += 2;
+            continue;
+        }
+
+        // "%[flags][width][.precision]" is kept, length modifiers are dropped
+        char spec[24];
+        size_t s = 0;
+        spec[s++] = *f++;
+        while (*f && strchr("-+ #0123456789.", *f) && s < sizeof(spec) - 4) spec[s++] = *f++;
+        while (*f && strchr("hlLqjzt", *f)) f++;
+        const char conv = *f ? *f++ : 'd';
+
+        if (arg >= e.arg_count) {
+            n += snprintf(out + n, room(), "<?>");
+            continue;
+        }
+        const ArgType type = e.types[arg++];
+        const uint64_t b = argBits(e, word, type);
+
+        int w = 0;
+        if (strchr("di", conv)) {
+            spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = conv; spec[s] = '\0';
+            w = snprintf(out + n, room(), spec, (long long)asInt(type, b));
+        } else if (strchr("uxXoc", conv)) {
+            if (conv != 'c') { spec[s++] = 'l'; spec[s++] = 'l'; }
+            spec[s++] = conv; spec[s] = '\0';
+            uint64_t v = type == ArgType::I32 ? (uint32_t)b : (uint64_t)asInt(type, b);
+            w = conv == 'c' ? snprintf(out + n, room(), spec, (int)v)
+                            : snprintf(out + n, room(), spec, (unsigned long long)v);
+        } else if (strchr("fFeEgGaA", conv)) {
+            spec[s++] = conv; spec[s] = '\0';
+            w = snprintf(out + n, room(), spec, asDouble(type, b));
+        } else if (conv == 's') {
+            spec[s++] = conv; spec[s] = '\0';
+            const char* str = type == ArgType::Str ? (const char*)(uintptr_t)b : nullptr;
+            w = snprintf(out + n, room(), spec, str ? str : "(?)");
+        } else {
+            w = snprintf(out + n, room(), "%p", (void*)(uintptr_t)b);
+        }
+        n += w > 0 ? (size_t)w : 0;
+    }
+    out[std::min(n, len - 1)] = '\0';
+}
+
+/// @brief Oldest published entry across the rings, or null.
+Ring* oldestReady() {
+    Ring* best = nullptr;
+    int64_t best_ts = 0;
+    for (Ring& r : g_rings) {
+        if (!r.slots) continue;
+        const Entry& e = r.slots[r.tail & r.mask];
+        if (e.seq.load(std::memory_order_acquire) != r.tail + 1) continue;
+        if (!best || e.timestamp_us < best_ts) {
+            best = &r;
+            best_ts = e.timestamp_us;
+        }
+    }
+    return best;
+}
+
+size_t drain() {
+    std::lock_guard<std::mutex> lock(g_consumer_mutex);
+    char line[192];
+    size_t count = 0;
+
+    while (Ring* r = oldestReady()) {
+        Entry& e = r->slots[r->tail & r->mask];
+        const Site* site = e.site;
+        int prefix = snprintf(line, sizeof(line), "(%lld) ", (long long)(e.timestamp_us / 1000));
+        formatEntry(e, line + prefix, sizeof(line) - prefix);
+
+        // Hand the slot back before the (slow) sink runs
+        e.seq.store(r->tail + r->mask + 1, std::memory_order_release);
+        r->tail++;
+
+        g_sink(site->level, site->tag, line);
+        g_emitted++;
+        count++;
+    }
+
+    const uint32_t dropped = g_dropped.load(std::memory_order_relaxed);
+    if (dropped != g_dropped_reported) {
+        snprintf(line, sizeof(line), "(%lld) %u log entries dropped (ring full)",
+                 (long long)(esp_timer_get_time() / 1000), (unsigned)(dropped - g_dropped_reported));
+        g_sink(Level::Warn, TAG, line);
+        g_dropped_reported = dropped;
+    }
+    return count;
+}
+
+void taskLoop() {
+    std::unique_lock<std::mutex> lock(g_task_mutex);
+    while (!g_stop) {
+        g_task_cv.wait_for(lock, std::chrono::milliseconds(g_interval_ms));
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+void stopTask() {
+    {
+        std::lock_guard<std::mutex> lock(g_task_mutex);
+        if (!g_task.joinable()) return;
+        g_stop = true;
+        g_task_cv.notify_one();
+    }
+    g_task.join();
+}
+
+} // namespace
+
+namespace detail {
+
+Entry* acquire(uint32_t* pos) {
+    // Announce the writer before looking at g_ready: shutdown() clears
+    // g_ready and then waits for g_writers to reach zero, so either we see
+    // false here or the rings stay allocated until commit().
+    g_writers.fetch_add(1, std::memory_order_seq_cst);
+
+    // Not running (early boot, after shutdown): commit() prints synchronously
+    if (!g_ready.load(std::memory_order_seq_cst)) {
+        g_writers.fetch_sub(1, std::memory_order_release);
+        *pos = 0;
+        return &t_unbuffered;
+    }
+
+    // Bounded MPMC ring (Vyukov): a slot is free for position p when its
+    // sequence equals p, and holds a published entry when it equals p + 1.
+    // Tasks preempting each other on one core both stay lock-free.
+    Ring& r = g_rings[currentCore()];
+    uint32_t p = r.head.load(std::memory_order_relaxed);
+    while (true) {
+        Entry& e = r.slots[p & r.mask];
+        const int32_t diff = (int32_t)(e.seq.load(std::memory_order_acquire) - p);
+        if (diff == 0) {
+            if (r.head.compare_exchange_weak(p, p + 1, std::memory_order_relaxed)) {
+                *pos = p;
+                return &e;
+            }
+        } else if (diff < 0) {
+            g_dropped.fetch_add(1, std::memory_order_relaxed);
+            g_writers.fetch_sub(1, std::memory_order_release);
+            return nullptr;
+        } else {
+            p = r.head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void commit(Entry* e, uint32_t pos) {
+    if (e == &t_unbuffered) {
+        char line[160];
+        formatEntry(*e, line, sizeof(line));
+        defaultSink(e->site->level, e->site->tag, line);
+        return;
+    }
+    e->seq.store(pos + 1, std::memory_order_release);
+    g_written.fetch_add(1, std::memory_order_relaxed);
+    g_writers.fetch_sub(1, std::memory_order_release);
+}
+
+} // namespace detail
+
+void init() {
+    init(Config());
+}
+
+bool init(const Config& config) {
+    shutdown();
+
+    size_t entries = 1;
+    while (entries < std::max<size_t>(config.ring_entries, 2)) entries <<= 1;
+
+    for (Ring& r : g_rings) {
+        // Internal SRAM: written on every hot-path log call
+        r.slots = (Entry*)heap_caps_malloc(entries * sizeof(Entry), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!r.slots) {
+            ESP_LOGE(TAG, "Failed to allocate %zu log entries", entries);
+            shutdown();
+            return false;
+        }
+        for (size_t i = 0; i < entries; i++) {
+            new (&r.slots[i].seq) std::atomic<uint32_t>((uint32_t)i);
+        }
+        r.mask = (uint32_t)(entries - 1);
+        r.head.store(0, std::memory_order_relaxed);
+        r.tail = 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_consumer_mutex);
+        g_sink = config.sink ? config.sink : defaultSink;
+        g_emitted = 0;
+        g_dropped_reported = 0;
+    }
+    g_written.store(0, std::memory_order_relaxed);
+    g_dropped.store(0, std::memory_order_relaxed);
+    detail::g_max_level.store((uint8_t)config.max_level, std::memory_order_relaxed);
+    g_ready.store(true, std::memory_order_release);
+
+    if (config.start_task) {
+        std::lock_guard<std::mutex> lock(g_task_mutex);
+#ifdef ESP_PLATFORM
+        esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+        cfg.stack_size = 4096;
+        cfg.prio = 1;
+        cfg.thread_name = "log_drain";
+        esp_pthread_set_cfg(&cfg);
+#endif
+        g_stop = false;
+        g_interval_ms = std::max<uint32_t>(config.flush_interval_ms, 1);
+        g_task = std::thread(taskLoop);
+    }
+    return true;
+}
+
+void shutdown() {
+    stopTask();
+    const bool was_ready = g_ready.exchange(false, std::memory_order_seq_cst);
+
+    // New writers now print synchronously; wait out the ones already inside
+    // a ring. Sleep rather than yield so lower-priority tasks get to commit.
+    while (g_writers.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (!was_ready) {
+        for (Ring& r : g_rings) {
+            heap_caps_free(r.slots);
+            r.slots = nullptr;
+        }
+        return;
+    }
+    drain();
+    std::lock_guard<std::mutex> lock(g_consumer_mutex);
+    for (Ring& r : g_rings) {
+        heap_caps_free(r.slots);
+        r.slots = nullptr;
+    }
+}
+
+size_t flush() {
+    if (!g_ready.load(std::memory_order_acquire)) return 0;
+    return drain();
+}
+
+Stats stats() {
+    Stats s;
+    s.written = g_written.load(std::memory_order_relaxed);
+    s.dropped = g_dropped.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(g_consumer_mutex);
+    s.emitted = g_emitted;
+    return s;
+}
+
+} // namespace Logger
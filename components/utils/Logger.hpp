@@ -1,16 +1,178 @@
 #pragma once
 
-/// @brief Thin abstraction around ESP-IDF logging macros.
+#include <esp_timer.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/// @brief Deferred binary logger for hot loops.
+///
+/// ESP_LOGx formats and writes to the UART on the calling task, which can
+/// stall the capture loop for milliseconds. The CCM_LOGx macros instead copy
+/// a pointer to the call site's static description (level, tag, format) and
+/// the raw argument words into a lock-free ring for the current core; a
+/// low-priority task formats and emits the entries later. When a ring is
+/// full the entry is dropped and counted, the caller never waits.
 ///
-/// This is mostly here to provide a single place to adjust logging behaviour,
-/// prefixes, or formatting, without touching application code everywhere.
+/// Arguments are stored by value, so "%s" arguments must outlive the entry
+/// (string literals, tags). Use ESP_LOGx for transient strings. Before init()
+/// and after shutdown() entries are formatted and printed synchronously.
 namespace Logger {
 
+enum class Level : uint8_t { Error = 0, Warn, Info, Debug };
+
+/// @brief Static description of a log call site; its address is the format id.
+struct Site {
+    Level level;
+    const char* tag;
+    const char* fmt;
+};
+
+/// @brief Receives each formatted line (default: ESP_LOGx at the entry's level).
+using Sink = void (*)(Level level, const char* tag, const char* line);
+
+struct Config {
+    size_t ring_entries = 64;          ///< Entries per core (rounded up to a power of two)
+    uint32_t flush_interval_ms = 20;   ///< How often the log task drains the rings
+    bool start_task = true;            ///< false: entries are only emitted by flush()
+    Level max_level = Level::Info;     ///< More verbose entries are discarded at the call site
+    Sink sink = nullptr;
+};
+
+struct Stats {
+    uint32_t written = 0;   ///< Entries stored in a ring
+    uint32_t emitted = 0;   ///< Entries formatted and handed to the sink
+    uint32_t dropped = 0;   ///< Entries lost because a ring was full
+};
+
+/// @brief Start with the default configuration.
 void init();
 
-// Future helpers might include:
-//  - Scoped timing logs
-//  - Conditional debug logging
-//  - Redirection to UART / network, etc.
+/// @brief Allocate the rings and start the log task. Re-initialising drains and restarts.
+bool init(const Config& config);
+
+/// @brief Emit everything pending, stop the task and free the rings.
+///
+/// Safe while other tasks are logging: calls arriving after this point print
+/// synchronously, and the rings are freed only once every write() that had
+/// already claimed a slot has committed it. init() shuts down the same way.
+void shutdown();
+
+/// @brief Format and emit all pending entries on the calling task.
+/// @return Number of entries emitted.
+size_t flush();
+
+Stats stats();
+
+namespace detail {
+
+static constexpr size_t kMaxArgs = 6;
+static constexpr size_t kMaxWords = 10;
+static constexpr size_t kMaxCores = 2;
+
+enum class ArgType : uint8_t { I32, U32, I64, U64, F64, Str, Ptr };
+
+struct Entry {
+    std::atomic<uint32_t> seq;   // Slot sequence number (bounded MPMC ring protocol)
+    const Site* site;
+    int64_t timestamp_us;
+    uint8_t arg_count;
+    ArgType types[kMaxArgs];
+    uint32_t words[kMaxWords];
+};
+
+struct Ring {
+    Entry* slots = nullptr;
+    uint32_t mask = 0;
+    std::atomic<uint32_t> head{0};  // Next slot producers claim
+    uint32_t tail = 0;              // Next slot the consumer reads
+};
+
+extern std::atomic<uint8_t> g_max_level;
+
+/// @brief Claim a slot in the current core's ring; null (and counted as dropped) if full.
+Entry* acquire(uint32_t* pos);
+
+/// @brief Publish a slot filled after acquire().
+void commit(Entry* e, uint32_t pos);
+
+template <typename T, typename = void>
+struct Arg;
+
+template <typename T>
+struct Arg<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type> {
+    using I = typename std::conditional<std::is_enum<T>::value, std::underlying_type<T>, std::common_type<T>>::type::type;
+    static constexpr bool kWide = sizeof(I) > 4;
+    static constexpr size_t kWords = kWide ? 2 : 1;
+    static constexpr ArgType kType = std::is_signed<I>::value ? (kWide ? ArgType::I64 : ArgType::I32)
+                                                              : (kWide ? ArgType::U64 : ArgType::U32);
+    static uint64_t bits(T v) { return kWide ? (uint64_t)(I)v : (uint64_t)(uint32_t)(I)v; }
+};
+
+template <typename T>
+struct Arg<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static constexpr size_t kWords = 2;
+    static constexpr ArgType kType = ArgType::F64;
+    static uint64_t bits(T v) {
+        double d = v;
+        uint64_t u;
+        __builtin_memcpy(&u, &d, sizeof(u));
+        return u;
+    }
+};
+
+template <typename T>
+struct Arg<T*, void> {
+    static constexpr bool kStr = std::is_same<typename std::remove_cv<T>::type, char>::value;
+    static constexpr size_t kWords = sizeof(T*) > 4 ? 2 : 1;
+    static constexpr ArgType kType = kStr ? ArgType::Str : ArgType::Ptr;
+    static uint64_t bits(T* v) { return (uint64_t)(uintptr_t)v; }
+};
+
+template <typename T>
+inline void put(Entry* e, size_t& word, size_t& index, T v) {
+    using A = Arg<T>;
+    const uint64_t b = A::bits(v);
+    e->types[index++] = A::kType;
+    e->words[word++] = (uint32_t)b;
+    if (A::kWords == 2) e->words[word++] = (uint32_t)(b >> 32);
+}
+
+template <typename... Args>
+constexpr size_t wordCount() {
+    return (size_t(0) + ... + Arg<Args>::kWords);
+}
+
+} // namespace detail
+
+/// @brief Store one entry; use the CCM_LOGx macros rather than calling this directly.
+template <typename... Args>
+inline void write(const Site& site, Args... args) {
+    static_assert(sizeof...(Args) <= detail::kMaxArgs, "too many log arguments");
+    static_assert(detail::wordCount<typename std::decay<Args>::type...>() <= detail::kMaxWords,
+                  "log arguments exceed the entry size");
+    if ((uint8_t)site.level > detail::g_max_level.load(std::memory_order_relaxed)) return;
+
+    uint32_t pos;
+    detail::Entry* e = detail::acquire(&pos);
+    if (!e) return;
+    e->site = &site;
+    e->timestamp_us = esp_timer_get_time();
+    e->arg_count = sizeof...(Args);
+    size_t word = 0, index = 0;
+    (detail::put<typename std::decay<Args>::type>(e, word, index, args), ...);
+    detail::commit(e, pos);
+}
 
 } // namespace Logger
+
+#define CCM_LOG_AT(level, tag, fmt, ...) do {                              \
+        static const Logger::Site ccm_log_site_ = {level, tag, fmt};       \
+        Logger::write(ccm_log_site_, ##__VA_ARGS__);                       \
+    } while (0)
+
+#define CCM_LOGE(tag, fmt, ...) CCM_LOG_AT(Logger::Level::Error, tag, fmt, ##__VA_ARGS__)
+#define CCM_LOGW(tag, fmt, ...) CCM_LOG_AT(Logger::Level::Warn, tag, fmt, ##__VA_ARGS__)
+#define CCM_LOGI(tag, fmt, ...) CCM_LOG_AT(Logger::Level::Info, tag, fmt, ##__VA_ARGS__)
+#define CCM_LOGD(tag, fmt, ...) CCM_LOG_AT(Logger::Level::Debug, tag, fmt, ##__VA_ARGS__)
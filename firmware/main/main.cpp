@@ -18,10 +18,16 @@
 
 #include "CameraNode.hpp"
 #include "CvPipeline.hpp"
+#include "Logger.hpp"
+#include "QualityGovernor.hpp"
+#include "SensorConfig.hpp"
 #include "Settings.hpp"
 
 static const char* TAG = "ccm-vision";
 
+// Per-frame processing budget the QualityGovernor holds (20 FPS).
+static constexpr int64_t kFrameBudgetUs = 50000;
+
 // Control flag for the main application loop.
 static std::atomic<bool> g_is_running(true);
 
@@ -33,6 +39,9 @@ extern "C" void app_main()
     ESP_LOGI(TAG, "Starting CCM ESP32 Vision Node (v%s)", app_desc->version);
     ESP_LOGI(TAG, "Compile Date: %s | Time: %s", app_desc->date, app_desc->time);
 
+    // Capture-loop logging goes through the deferred logger's rings
+    Logger::init();
+
     // --- 1. Load Settings (NVS) ---
     if (Settings::get().init() != ESP_OK) {
         ESP_LOGE(TAG, "Critical Failure: Settings init failed");
@@ -41,18 +50,41 @@ extern "C" void app_main()
 
     // --- 2. Hardware Initialization ---
     CameraNode camera;
-    if (!camera.init()) {
+    CameraNode::Config cam_config;
+    cam_config.pixel_format = PIXFORMAT_RGB565;   // CvPipeline reads raw RGB565 frames
+    if (!camera.init(cam_config)) {
         ESP_LOGE(TAG, "Camera initialization failed. System halted.");
         return;
     }
 
+    // Push ROI / downsampling into the sensor where it supports it; the
+    // returned plan holds the software stages that remain.
+    SensorConfig sensor;
+    SensorPlan plan;
+    plan.pipeline = Settings::get().cfg();
+    if (sensor.init(camera.sensor(), cam_config.frame_size) != ESP_OK ||
+        sensor.apply(Settings::get().cfg(), &plan) != ESP_OK) {
+        ESP_LOGW(TAG, "Sensor offload unavailable, using software ROI/downsampling");
+        plan.pipeline = Settings::get().cfg();
+    }
+
     // --- 3. Pipeline Configuration ---
     CvPipeline pipeline;
     
-    // Apply the loaded configuration from NVS
-    pipeline.configure(Settings::get().cfg());
+    // Apply the loaded configuration from NVS.
+    // All pipeline memory is reserved here; the capture loop never allocates.
+    if (!pipeline.configure(plan.pipeline)) {
+        ESP_LOGE(TAG, "Pipeline arena allocation failed. System halted.");
+        return;
+    }
     ESP_LOGI(TAG, "Pipeline configured from NVS settings");
 
+    // Trades optional stages, resolution and ROI size for latency under load.
+    QualityGovernor governor;
+    GovernorConfig governor_cfg;
+    governor_cfg.budget_us = kFrameBudgetUs;
+    governor.init(plan.pipeline, governor_cfg, plan.frame_w, plan.frame_h);
+
     // --- 4. Main Capture Loop ---
     int64_t last_log_time = esp_timer_get_time();
     int frame_count = 0;
@@ -62,7 +94,7 @@ extern "C" void app_main()
         // A. Capture
         auto* fb = camera.capture();
         if (!fb) {
-            ESP_LOGE(TAG, "Frame capture failed");
+            CCM_LOGE(TAG, "Frame capture failed");
             vTaskDelay(pdMS_TO_TICKS(100)); // Prevent tight loop on error
             continue;
         }
@@ -71,6 +103,7 @@ extern "C" void app_main()
         int64_t start_proc = esp_timer_get_time();
         pipeline.process(fb);
         int64_t end_proc = esp_timer_get_time();
+        FrameQuality quality = governor.update(pipeline, end_proc - start_proc);
 
         // C. Release
         camera.release(fb);
@@ -82,7 +115,8 @@ extern "C" void app_main()
         const auto& blobs = pipeline.getBlobs();
         if (!blobs.empty()) {
             const auto& b = blobs[0];
-            ESP_LOGD(TAG, "Blob Detected: Area=%u Center=(%u, %u)", b.area, b.cx, b.cy);
+            CCM_LOGD(TAG, "Blob Detected: Area=%u Center=(%u, %u) (quality L%u, 1/%u scale)",
+                     b.area, b.cx, b.cy, quality.level, quality.downsample);
         }
 
         // Periodic Performance Logging
@@ -91,13 +125,25 @@ extern "C" void app_main()
             float fps = 50.0f / ((now - last_log_time) / 1000000.0f);
             int64_t proc_ms = (end_proc - start_proc) / 1000;
 
-            ESP_LOGI(TAG, "FPS: %.2f | Proc Time: %lld ms | Blobs: %u | Output: %ux%u", 
-                     fps, proc_ms, blobs.size(), pipeline.getWidth(), pipeline.getHeight());
+            CCM_LOGI(TAG, "FPS: %.2f | Proc Time: %lld ms | Blobs: %u | Output: %ux%u | Quality: L%u",
+                     fps, proc_ms, blobs.size(), pipeline.getWidth(), pipeline.getHeight(), quality.level);
             
             last_log_time = now;
             frame_count = 0;
         }
 
+        // Results are consumed; switch quality level before the next frame.
+        // Every level fits the arena reserved above, so this does not allocate.
+        // A rejected level leaves the pipeline without buffers: go back to the
+        // level that worked so the governor and the pipeline stay in step.
+        if (quality.changed && !pipeline.configure(governor.config())) {
+            CCM_LOGE(TAG, "Pipeline rejected quality level L%u, staying at L%u", quality.next_level, quality.level);
+            governor.restoreLevel(quality.level);
+            if (!pipeline.configure(governor.config())) {
+                CCM_LOGE(TAG, "Pipeline reconfiguration failed at L%u", quality.level);
+            }
+        }
+
         // Yield to watchdog
         vTaskDelay(1); 
     }
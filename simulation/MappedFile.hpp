@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only mmap() of a whole file (host only).
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+
+        m_data = static_cast<const uint8_t*>(p);
+        m_len = st.st_size;
+        return true;
+    }
+
+    void close() {
+        if (m_data) munmap(const_cast<uint8_t*>(m_data), m_len);
+        m_data = nullptr;
+        m_len = 0;
+    }
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_len; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_len = 0;
+};
@@ -0,0 +1,208 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "CvPipeline.hpp"
+#include "SimScenarios.hpp"
+
+// Gray image -> RGB565 frame, then the pipeline's own grayscale for the reference.
+static void loadGray(camera_fb_t* fb, const std::vector<uint8_t>& gray) {
+    uint16_t* px = (uint16_t*)fb->buf;
+    for (size_t i = 0; i < gray.size(); i++) px[i] = grayToRgb565(gray[i]);
+}
+
+// Brute-force separable box filter, edges replicated, rounded to nearest.
+static void referenceBox(std::vector<uint8_t>& img, int w, int h, int r) {
+    std::vector<uint8_t> tmp(img.size());
+    int n = 2 * r + 1;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int s = 0;
+            for (int i = -r; i <= r; i++) s += img[y * w + std::min(std::max(x + i, 0), w - 1)];
+            tmp[y * w + x] = (uint8_t)((s + n / 2) / n);
+        }
+    }
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int s = 0;
+            for (int i = -r; i <= r; i++) s += tmp[std::min(std::max(y + i, 0), h - 1) * w + x];
+            img[y * w + x] = (uint8_t)((s + n / 2) / n);
+        }
+    }
+}
+
+// Validates the running-sum box blur, its Gaussian approximation, flat
+// cost across radii and its effect on a noisy low-light mask.
+int runBlurSim() {
+    printf("\n--- CCM Simulation: Box Blur Test ---\n");
+    int failures = 0;
+    srand(4321);
+
+    // 1. Exactness (within rounding) against a brute-force reference.
+    {
+        const int w = 97, h = 53;
+        camera_fb_t fb;
+        makeFrame(&fb, w, h);
+        std::vector<uint8_t> gray(w * h);
+        for (auto& g : gray) g = rand() & 0xFF;
+        loadGray(&fb, gray);
+
+        PipelineConfig base;
+        base.max_frame_w = w;
+        base.max_frame_h = h;
+        CvPipeline plain;
+        plain.configure(base);
+        plain.process(&fb);
+        std::vector<uint8_t> luma(plain.getOutput(), plain.getOutput() + w * h);
+
+        int worst = 0;
+        for (int r : {1, 2, 5, 20, 60}) {
+            PipelineConfig config = base;
+            config.blur_radius = (uint8_t)r;
+            CvPipeline p;
+            p.configure(config);
+            p.process(&fb);
+            std::vector<uint8_t> ref = luma;
+            referenceBox(ref, w, h, r);
+            for (int i = 0; i < w * h; i++) worst = std::max(worst, std::abs(p.getOutput()[i] - ref[i]));
+        }
+        failures += SIM_CHECK(worst <= 1, "box blur matches brute force within rounding (max diff %d)", worst);
+        free(fb.buf);
+    }
+
+    // 2. Three passes approximate a Gaussian: profile of a 1-pixel bright line.
+    {
+        const int w = 64, h = 16, r = 2, passes = 3;
+        camera_fb_t fb;
+        makeFrame(&fb, w, h);
+        std::vector<uint8_t> gray(w * h, 0);
+        for (int y = 0; y < h; y++) gray[y * w + 32] = 255;
+        loadGray(&fb, gray);
+
+        PipelineConfig config;
+        config.max_frame_w = w;
+        config.max_frame_h = h;
+        config.blur_radius = r;
+        config.blur_passes = passes;
+        CvPipeline p;
+        p.configure(config);
+        p.process(&fb);
+        const uint8_t* row = p.getOutput() + (h / 2) * w;
+
+        // Exact 3-fold box kernel vs the Gaussian of equal variance
+        std::vector<double> k(1, 1.0);
+        for (int i = 0; i < passes; i++) {
+            std::vector<double> nk(k.size() + 2 * r, 0.0);
+            for (size_t a = 0; a < k.size(); a++)
+                for (int b = 0; b <= 2 * r; b++) nk[a + b] += k[a] / (2 * r + 1);
+            k = nk;
+        }
+        double sigma = std::sqrt(passes * ((2.0 * r + 1) * (2 * r + 1) - 1) / 12.0);
+        int c = (int)k.size() / 2;
+        bool match = true;
+        double gauss_err = 0;
+        printf("  %-4s %8s %8s %8s\n", "dx", "blur", "box^3", "gauss");
+        for (int dx = 0; dx <= c; dx++) {
+            double box = 255 * k[c + dx];
+            double g = 255 * std::exp(-dx * dx / (2 * sigma * sigma)) / (std::sqrt(2 * M_PI) * sigma);
+            printf("  %-4d %8d %8.1f %8.1f\n", dx, row[32 + dx], box, g);
+            match &= std::abs(row[32 + dx] - box) <= 2 && row[32 + dx] == row[32 - dx];
+            gauss_err = std::max(gauss_err, std::fabs(box - g));
+        }
+        failures += SIM_CHECK(match, "3 passes reproduce the cascaded box kernel (symmetric, within 2)");
+        failures += SIM_CHECK(gauss_err < 0.1 * 255 * k[c], "cascaded box is within 10%% of peak of a Gaussian (sigma %.2f)", sigma);
+        free(fb.buf);
+    }
+
+    // 3. Cost is flat across radii.
+    camera_fb_t fb;
+    makeFrame(&fb, 320, 240);
+    std::vector<uint8_t> scene(320 * 240);
+    const int kObjects = 4;
+    for (size_t y = 0; y < 240; y++) {
+        for (size_t x = 0; x < 320; x++) {
+            int v = 60;
+            for (int o = 0; o < kObjects; o++) {
+                int ox = 30 + o * 75, oy = 90;
+                if ((int)x >= ox && (int)x < ox + 40 && (int)y >= oy && (int)y < oy + 40) v = 140;
+            }
+            v += (rand() % 121) - 60; // low-light sensor noise
+            scene[y * 320 + x] = (uint8_t)std::min(std::max(v, 0), 255);
+        }
+    }
+    loadGray(&fb, scene);
+
+    const int kRuns = 10;
+    int64_t t_first = 0, t_last = 0;
+    printf("  %-7s %10s\n", "Radius", "Blur (us)");
+    const int radii[] = {1, 2, 4, 8, 16, 32};
+    for (int r : radii) {
+        PipelineConfig config;
+        config.blur_radius = (uint8_t)r;
+        CvPipeline p;
+        p.configure(config);
+        int64_t t = 0;
+        for (int i = 0; i < kRuns; i++) {
+            p.process(&fb);
+            t += p.getStageTimeUs(PipelineStage::Blur);
+        }
+        printf("  %-7d %10lld\n", r, (long long)(t / kRuns));
+        if (r == radii[0]) t_first = t;
+        t_last = t;
+    }
+    failures += SIM_CHECK(t_last < 2 * t_first, "radius 32 costs less than twice radius 1");
+
+    // 4. Low-light scene: blur before threshold removes fragmentation.
+    PipelineConfig config;
+    config.enable_threshold = true;
+    config.threshold_val = 100;
+    config.enable_blob_detection = true;
+    config.min_blob_area = 4;
+    config.max_blobs = 255;
+    CvPipeline noisy;
+    noisy.configure(config);
+    noisy.process(&fb);
+
+    config.blur_radius = 2;
+    config.blur_passes = 2;
+    CvPipeline smoothed;
+    smoothed.configure(config);
+    smoothed.process(&fb);
+    printf("  Blobs: no blur %zu (+%u dropped) | blur r=2 x2 %zu\n",
+           noisy.getBlobs().size(), noisy.getDroppedBlobs(), smoothed.getBlobs().size());
+    failures += SIM_CHECK(smoothed.getBlobs().size() == kObjects, "blurred mask yields exactly the %d objects", kObjects);
+    failures += SIM_CHECK(noisy.getBlobs().size() > (size_t)kObjects, "unblurred mask is fragmented");
+
+    // 5. Strip mode hands the gray image to the blur and thresholds afterwards.
+    config.strip_rows = 16;
+    CvPipeline strip;
+    strip.configure(config);
+    strip.process(&fb);
+    bool same = strip.getWidth() == smoothed.getWidth() && strip.getHeight() == smoothed.getHeight() &&
+                memcmp(strip.getOutput(), smoothed.getOutput(), strip.getWidth() * strip.getHeight()) == 0;
+    failures += SIM_CHECK(same, "strip executor with blur matches whole-frame output");
+
+    // 6. Saturated input stays white at every radius (no wrap past 255).
+    scene.assign(320 * 240, 255);
+    loadGray(&fb, scene);
+    int wrapped = 0;
+    for (int r = 1; r <= 255; r++) {
+        PipelineConfig white;
+        white.blur_radius = (uint8_t)r;
+        CvPipeline p;
+        p.configure(white);
+        p.process(&fb);
+        const uint8_t* out = p.getOutput();
+        for (size_t i = 0; i < p.getWidth() * p.getHeight(); i++) {
+            if (out[i] != 255) {
+                wrapped++;
+                break;
+            }
+        }
+    }
+    failures += SIM_CHECK(wrapped == 0, "all-white frame stays 255 for radii 1-255 (%d radii changed)", wrapped);
+
+    free(fb.buf);
+    return failures;
+}
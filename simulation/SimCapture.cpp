@@ -0,0 +1,216 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include "CaptureReader.hpp"
+#include "CaptureReplay.hpp"
+#include "CaptureWriter.hpp"
+#include "CvPipeline.hpp"
+#include "esp_timer.h"
+#include "MappedFile.hpp"
+#include "QualityGovernor.hpp"
+#include "SimScenarios.hpp"
+
+static const char* kCapturePath = "sim_capture.ccap";
+
+static void drawSquare(camera_fb_t* fb, int x, int y, int size) {
+    memset(fb->buf, 0, fb->len);
+    fillRect(fb, x, y, size, size);
+}
+
+static PipelineConfig replayConfig() {
+    PipelineConfig config;
+    config.enable_threshold = true;
+    config.threshold_val = 100;
+    config.enable_blob_detection = true;
+    config.min_blob_area = 20;
+    return config;
+}
+
+struct ReplayCheck {
+    std::vector<Blob> live;
+    int mismatches = 0;
+};
+
+static void compareWithLive(size_t index, const CaptureFrame&, const CvPipeline& pipeline,
+                            int64_t, void* user) {
+    auto* check = static_cast<ReplayCheck*>(user);
+    const auto& blobs = pipeline.getBlobs();
+    const Blob& expect = check->live[index];
+    if (blobs.size() != 1 || blobs[0].x != expect.x || blobs[0].cx != expect.cx ||
+        blobs[0].area != expect.area) {
+        check->mismatches++;
+    }
+}
+
+// Records synthetic frames, replays them from an mmap()ed file and checks
+// that results match the live run bit for bit.
+int runCaptureSim() {
+    printf("\n--- CCM Simulation: Capture Record & Replay Test ---\n");
+    int failures = 0;
+    const int kFrames = 20;
+    const int64_t kFrameIntervalUs = 5000;
+
+    camera_fb_t fb;
+    makeFrame(&fb, 320, 240);
+
+    // 1. Record while processing live.
+    CvPipeline live;
+    live.configure(replayConfig());
+    ReplayCheck check;
+
+    FILE* f = fopen(kCapturePath, "wb");
+    FileSink sink(f);
+    capture::CaptureIndexEntry index[kFrames];
+    CaptureWriter writer(sink, index, kFrames);
+    writer.begin();
+    for (int i = 0; i < kFrames; i++) {
+        drawSquare(&fb, 10 + i * 14, 60 + i * 5, 30);
+        live.process(&fb);
+        check.live.push_back(live.getBlobs()[0]);
+        writer.writeFrame(&fb, 1000000 + i * kFrameIntervalUs);
+    }
+    writer.finish();
+    fclose(f);
+    printf("  Recorded %u frames, %llu bytes\n", writer.frameCount(), (unsigned long long)writer.bytesWritten());
+
+    // 2. Replay from the memory-mapped file.
+    MappedFile mapped;
+    failures += SIM_CHECK(mapped.open(kCapturePath), "capture file mmap()ed");
+
+    CaptureReader reader;
+    failures += SIM_CHECK(reader.open(mapped.data(), mapped.size()) && !reader.recovered() &&
+                          reader.frameCount() == (size_t)kFrames, "index loaded (%zu frames)",
+                          reader.frameCount());
+
+    CaptureFrame frame;
+    size_t idx = reader.seek(1000000 + 7 * kFrameIntervalUs + 10);
+    failures += SIM_CHECK(idx == 7 && reader.frame(idx, frame) && frame.fb.width == 320 &&
+                          frame.fb.format == PIXFORMAT_RGB565, "seek by timestamp lands on frame %zu", idx);
+
+    CvPipeline pipeline;
+    pipeline.configure(replayConfig());
+    ReplayStats fast = CaptureReplay::run(reader, pipeline, ReplaySpeed::Maximum, compareWithLive, &check);
+    printf("  Max speed:      %zu frames | avg %.0f us | min %lld us | max %lld us | wall %lld us\n",
+           fast.frames, fast.avgProcUs(), (long long)fast.min_proc_us, (long long)fast.max_proc_us,
+           (long long)fast.wall_us);
+    failures += SIM_CHECK(fast.frames == (size_t)kFrames && check.mismatches == 0,
+                          "replayed blobs match live run (%d mismatches)", check.mismatches);
+
+    ReplayStats paced = CaptureReplay::run(reader, pipeline, ReplaySpeed::Recorded);
+    int64_t recorded_span = (kFrames - 1) * kFrameIntervalUs;
+    printf("  Recorded speed: %zu frames | wall %lld us (recorded span %lld us)\n",
+           paced.frames, (long long)paced.wall_us, (long long)recorded_span);
+    failures += SIM_CHECK(paced.wall_us >= recorded_span, "recorded-speed replay honours timestamps");
+
+    // 3. A truncated recording (no footer, partial last frame) is still readable.
+    size_t cut = mapped.size() - sizeof(capture::CaptureFooter) - kFrames * sizeof(capture::CaptureIndexEntry) - 100;
+    CaptureReader truncated;
+    truncated.open(mapped.data(), cut);
+    failures += SIM_CHECK(truncated.recovered() && truncated.frameCount() == (size_t)kFrames - 1,
+                          "truncated capture recovers %zu complete frames", truncated.frameCount());
+
+    mapped.close();
+
+    // 4. JPEG-sized payloads: records and index entries land on 4-byte (not
+    //    8-byte) boundaries and must still read back exactly.
+    const size_t kJpegFrames = 6;
+    f = fopen(kCapturePath, "wb");
+    FileSink jpeg_sink(f);
+    CaptureWriter jpeg_writer(jpeg_sink, index, kJpegFrames);
+    jpeg_writer.begin();
+    camera_fb_t jpeg = fb;
+    jpeg.format = PIXFORMAT_JPEG;
+    for (size_t i = 0; i < kJpegFrames; i++) {
+        jpeg.len = 1001 + i * 2;
+        jpeg_writer.writeFrame(&jpeg, 2000000 + i * kFrameIntervalUs);
+    }
+    jpeg_writer.finish();
+    fclose(f);
+    bool jpeg_ok = mapped.open(kCapturePath) && reader.open(mapped.data(), mapped.size()) &&
+                   !reader.recovered() && reader.frameCount() == kJpegFrames;
+    for (size_t i = 0; jpeg_ok && i < kJpegFrames; i++) {
+        jpeg_ok = reader.frame(i, frame) && frame.fb.len == 1001 + i * 2 &&
+                  frame.timestamp_us == (int64_t)(2000000 + i * kFrameIntervalUs) &&
+                  frame.fb.format == PIXFORMAT_JPEG && memcmp(frame.fb.buf, fb.buf, frame.fb.len) == 0;
+    }
+    failures += SIM_CHECK(jpeg_ok, "odd-length payloads read back from 4-byte aligned records");
+
+    mapped.close();
+    remove(kCapturePath);
+    free(fb.buf);
+    return failures;
+}
+
+static void printBlobs(size_t index, const CaptureFrame& frame, const CvPipeline& pipeline,
+                       int64_t proc_us, void*) {
+    const auto& blobs = pipeline.getBlobs();
+    printf("[Frame %4zu] t=%lld us | %zux%zu | proc %lld us | Blobs: %zu",
+           index, (long long)frame.timestamp_us, frame.fb.width, frame.fb.height,
+           (long long)proc_us, blobs.size());
+    if (!blobs.empty()) {
+        printf(" -> first at x=%d y=%d (w=%d h=%d)", blobs[0].x, blobs[0].y, blobs[0].w, blobs[0].h);
+    }
+    printf("\n");
+}
+
+// vision_sim --replay <file> [--realtime] [--budget <us>]
+int runReplayFile(const char* path, bool realtime, int64_t budget_us) {
+    MappedFile mapped;
+    CaptureReader reader;
+    if (!mapped.open(path) || !reader.open(mapped.data(), mapped.size())) {
+        printf("Cannot read capture '%s'\n", path);
+        return 1;
+    }
+
+    CvPipeline pipeline;
+    PipelineConfig config = replayConfig();
+    CaptureFrame first;
+    if (reader.frame(0, first)) {
+        config.max_frame_w = (uint16_t)first.fb.width;
+        config.max_frame_h = (uint16_t)first.fb.height;
+    }
+    pipeline.configure(config);
+
+    if (budget_us <= 0) {
+        ReplayStats stats = CaptureReplay::run(reader, pipeline,
+            realtime ? ReplaySpeed::Recorded : ReplaySpeed::Maximum, printBlobs, nullptr);
+        printf("Replayed %zu frames | avg %.0f us | min %lld us | max %lld us | wall %lld us\n",
+               stats.frames, stats.avgProcUs(), (long long)stats.min_proc_us,
+               (long long)stats.max_proc_us, (long long)stats.wall_us);
+        return 0;
+    }
+
+    // Governed replay: the configuration changes between frames, so frames
+    // are fed one by one with the measured processing time.
+    QualityGovernor governor;
+    GovernorConfig gcfg;
+    gcfg.budget_us = budget_us;
+    governor.init(config, gcfg, config.max_frame_w, config.max_frame_h);
+
+    size_t late = 0;
+    size_t changes = 0;
+    CaptureFrame frame;
+    for (size_t i = 0; i < reader.frameCount() && reader.frame(i, frame); i++) {
+        int64_t start = esp_timer_get_time();
+        pipeline.process(&frame.fb);
+        int64_t proc_us = esp_timer_get_time() - start;
+
+        FrameQuality q = governor.update(pipeline, proc_us);
+        if (proc_us > budget_us) late++;
+        printf("[Frame %4zu] level %u (ds %u) | proc %lld us (avg %lld) | fg %u permille | Blobs: %u\n",
+               i, q.level, q.downsample, (long long)q.proc_us, (long long)q.smoothed_us,
+               q.fg_permille, q.blobs);
+        if (q.changed) {
+            if (!pipeline.configure(governor.config())) {
+                governor.restoreLevel(q.level);
+                pipeline.configure(governor.config());
+            }
+            changes++;
+        }
+    }
+    printf("Replayed %zu frames | budget %lld us | %zu late | %zu level changes | final level %u\n",
+           reader.frameCount(), (long long)budget_us, late, changes, governor.level());
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "CvPipeline.hpp"
+#include "SimScenarios.hpp"
+#include "esp_timer.h"
+
+static const Blob* findBlob(const CvPipeline& p, uint8_t class_id, int x, int y) {
+    for (const Blob& b : p.getBlobs()) {
+        if (b.class_id == class_id && b.x == x && b.y == y) return &b;
+    }
+    return nullptr;
+}
+
+// Segments an orange part, a blue part and a red part (hue wrap-around) on
+// a grey conveyor with one LUT read per pixel, one blob list tagged by class.
+int runColorSim() {
+    printf("\n--- CCM Simulation: Colour Segmentation Test ---\n");
+    int failures = 0;
+
+    camera_fb_t fb;
+    makeFrame(&fb, 320, 240);
+    fillRect(&fb, 0, 0, 320, 240, rgb565(128, 128, 128));  // grey conveyor
+    fillRect(&fb, 20, 30, 40, 30, rgb565(255, 140, 0));     // orange
+    fillRect(&fb, 150, 100, 30, 50, rgb565(30, 60, 220));   // blue
+    fillRect(&fb, 240, 160, 50, 40, rgb565(220, 20, 30));   // red
+    fillRect(&fb, 100, 180, 20, 20, rgb565(250, 250, 250)); // white: no class
+
+    PipelineConfig config;
+    config.enable_color = true;
+    config.enable_blob_detection = true;
+    config.min_blob_area = 50;
+    config.color_class_count = 3;
+    config.color_classes[0] = {ColorSpace::HSV, {10, 150, 120}, {22, 255, 255}};   // orange
+    config.color_classes[1] = {ColorSpace::YUV, {0, 170, 0}, {255, 255, 120}};     // blue: high U
+    config.color_classes[2] = {ColorSpace::HSV, {170, 150, 100}, {5, 255, 255}};   // red, wraps through 0
+
+    CvPipeline p;
+    int64_t t0 = esp_timer_get_time();
+    bool ok = p.configure(config);
+    int64_t t_lut = esp_timer_get_time() - t0;
+    failures += SIM_CHECK(ok, "configure() builds the 64 KiB class LUT (%lld us)", (long long)t_lut);
+    p.process(&fb);
+
+    const Blob* orange = findBlob(p, 0, 20, 30);
+    const Blob* blue = findBlob(p, 1, 150, 100);
+    const Blob* red = findBlob(p, 2, 240, 160);
+    failures += SIM_CHECK(p.getBlobs().size() == 3, "exactly three coloured parts found (%zu)", p.getBlobs().size());
+    failures += SIM_CHECK(orange && orange->w == 40 && orange->h == 30, "orange part tagged class 0");
+    failures += SIM_CHECK(blue && blue->area == 30 * 50, "blue part tagged class 1 (YUV range)");
+    failures += SIM_CHECK(red && red->area == 50 * 40, "red part tagged class 2 (hue wrap-around)");
+
+    const uint8_t* mask = p.getOutput();
+    failures += SIM_CHECK(mask[35 * 320 + 30] == 0x01 && mask[0] == 0 && mask[190 * 320 + 110] == 0,
+                          "output holds per-pixel class bitmasks");
+
+    // Overlapping classes set several bits in one pass.
+    config.color_class_count = 4;
+    config.color_classes[3] = {ColorSpace::HSV, {0, 100, 100}, {30, 255, 255}}; // any warm colour
+    CvPipeline overlap;
+    overlap.configure(config);
+    overlap.process(&fb);
+    failures += SIM_CHECK(overlap.getOutput()[35 * 320 + 30] == 0x09, "orange pixel matches classes 0 and 3");
+    failures += SIM_CHECK(findBlob(overlap, 3, 20, 30) != nullptr, "overlapping class yields its own blob");
+
+    // Stages the class mask does not go through are rejected, not skipped.
+    PipelineConfig unsupported[5];
+    for (PipelineConfig& c : unsupported) c = config;
+    unsupported[0].blur_radius = 1;
+    unsupported[1].enable_threshold = true;
+    unsupported[2].morph_op = MorphOp::Open;
+    unsupported[3].enable_edges = true;
+    unsupported[4].strip_rows = 16;
+    bool rejected = true;
+    for (const PipelineConfig& c : unsupported) rejected &= !overlap.configure(c);
+    overlap.process(&fb);
+    failures += SIM_CHECK(rejected && overlap.getOutput()[35 * 320 + 30] == 0x09,
+                          "blur, threshold, morphology, edges and strips rejected, previous config kept");
+
+    // Cost: one table read per pixel versus grayscale conversion.
+    PipelineConfig gray_cfg;
+    CvPipeline gray;
+    gray.configure(gray_cfg);
+    const int kRuns = 20;
+    int64_t t_gray = 0, t_color = 0;
+    for (int i = 0; i < kRuns; i++) {
+        gray.process(&fb);
+        t_gray += gray.getStageTimeUs(PipelineStage::Grayscale);
+        p.process(&fb);
+        t_color += p.getStageTimeUs(PipelineStage::Grayscale);
+    }
+    printf("  Grayscale %lld us | colour classify (3 classes) %lld us\n",
+           (long long)(t_gray / kRuns), (long long)(t_color / kRuns));
+
+    free(fb.buf);
+    return failures;
+}
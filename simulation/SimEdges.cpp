@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "CvPipeline.hpp"
+#include "SimScenarios.hpp"
+
+// Reference Sobel on a materialised gray frame, borders replicated.
+static void referenceSobel(const uint8_t* gray, int w, int h, uint8_t th, std::vector<uint8_t>& out) {
+    auto at = [&](int x, int y) -> int {
+        x = std::min(std::max(x, 0), w - 1);
+        y = std::min(std::max(y, 0), h - 1);
+        return gray[y * w + x];
+    };
+    out.assign(w * h, 0);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int gx = (at(x + 1, y - 1) + 2 * at(x + 1, y) + at(x + 1, y + 1))
+                   - (at(x - 1, y - 1) + 2 * at(x - 1, y) + at(x - 1, y + 1));
+            int gy = (at(x - 1, y + 1) + 2 * at(x, y + 1) + at(x + 1, y + 1))
+                   - (at(x - 1, y - 1) + 2 * at(x, y - 1) + at(x + 1, y - 1));
+            int mag = (std::abs(gx) + std::abs(gy)) >> 3;
+            out[y * w + x] = th ? (mag >= th ? 255 : 0) : (uint8_t)mag;
+        }
+    }
+}
+
+// Validates the fused Sobel stage against a reference on a materialised
+// gray frame, its direction bins, and edge masks feeding blob detection.
+int runEdgesSim() {
+    printf("\n--- CCM Simulation: Sobel Edge Test ---\n");
+    int failures = 0;
+    srand(777);
+
+    // 1. Exactness on random content with an odd size.
+    {
+        const int w = 53, h = 31;
+        camera_fb_t fb;
+        makeFrame(&fb, w, h);
+        uint16_t* px = (uint16_t*)fb.buf;
+        for (int i = 0; i < w * h; i++) px[i] = (uint16_t)rand();
+
+        PipelineConfig config;
+        config.max_frame_w = w;
+        config.max_frame_h = h;
+        CvPipeline gray;
+        gray.configure(config);
+        gray.process(&fb);
+
+        bool ok = true;
+        for (uint8_t th : {0, 20}) {
+            config.enable_edges = true;
+            config.edge_threshold = th;
+            CvPipeline edges;
+            edges.configure(config);
+            edges.process(&fb);
+            std::vector<uint8_t> ref;
+            referenceSobel(gray.getOutput(), w, h, th, ref);
+            ok &= memcmp(ref.data(), edges.getOutput(), w * h) == 0;
+        }
+        failures += SIM_CHECK(ok, "fused Sobel matches a reference on a materialised gray frame");
+        free(fb.buf);
+    }
+
+    camera_fb_t fb;
+    makeFrame(&fb, 320, 240);
+    fillRect(&fb, 60, 60, 80, 50, 0xFFFF);
+
+    // 2. Direction bins on the sides of an axis-aligned rectangle.
+    PipelineConfig config;
+    config.enable_edges = true;
+    config.edge_direction = true;
+    CvPipeline dir;
+    dir.configure(config);
+    dir.process(&fb);
+    const uint8_t* d = dir.getEdgeDirection();
+    bool bins = d && d[85 * 320 + 60] == EdgeDir0 && d[85 * 320 + 139] == EdgeDir0 &&
+                d[60 * 320 + 100] == EdgeDir90 && d[109 * 320 + 100] == EdgeDir90 &&
+                d[60 * 320 + 60] == EdgeDir45 && d[60 * 320 + 139] == EdgeDir135;
+    failures += SIM_CHECK(bins, "vertical / horizontal / diagonal edges land in the right bins");
+
+    // 3. Edge mask feeds blob detection: the outline is one blob.
+    config.edge_direction = false;
+    config.enable_blob_detection = true;
+    config.min_blob_area = 50;
+    CvPipeline edges;
+    edges.configure(config);
+    edges.process(&fb);
+    const FixedVector<Blob>& blobs = edges.getBlobs();
+    bool outline = blobs.size() == 1 && blobs[0].x == 59 && blobs[0].y == 59 &&
+                   blobs[0].w == 82 && blobs[0].h == 52;
+    failures += SIM_CHECK(outline, "rectangle outline is one blob (%zu found)", blobs.size());
+
+    // 3b. ROI + downsampling: the gradient runs on the sampled ROI grid, so
+    //     it matches a reference on the gray output of the same ROI / factor,
+    //     step edges survive any factor and directions line up with the output.
+    for (uint8_t ds : {2, 3, 4}) {
+        PipelineConfig gray_cfg;
+        gray_cfg.enable_roi = true;
+        gray_cfg.roi_x = 31;
+        gray_cfg.roi_y = 17;
+        gray_cfg.roi_w = 250;
+        gray_cfg.roi_h = 190;
+        gray_cfg.downsample_factor = ds;
+        CvPipeline gray;
+        gray.configure(gray_cfg);
+        gray.process(&fb);
+
+        PipelineConfig roi_cfg = gray_cfg;
+        roi_cfg.enable_edges = true;
+        roi_cfg.edge_direction = true;
+        roi_cfg.enable_blob_detection = true;
+        roi_cfg.min_blob_area = 20;
+        CvPipeline sampled;
+        sampled.configure(roi_cfg);
+        sampled.process(&fb);
+        const int w = (int)gray.getWidth(), h = (int)gray.getHeight();
+        std::vector<uint8_t> ref;
+        referenceSobel(gray.getOutput(), w, h, roi_cfg.edge_threshold, ref);
+
+        // Blob detection consumed the mask, so compare the reference's outline instead
+        const FixedVector<Blob>& rb = sampled.getBlobs();
+        int x0 = w, y0 = h, x1 = -1, y1 = -1;
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                if (!ref[y * w + x]) continue;
+                x0 = std::min(x0, x); x1 = std::max(x1, x);
+                y0 = std::min(y0, y); y1 = std::max(y1, y);
+            }
+        }
+        const uint8_t* dd = sampled.getEdgeDirection();
+        const int mid_y = (y0 + y1) / 2;
+        bool ok = sampled.getWidth() == (size_t)w && sampled.getHeight() == (size_t)h && rb.size() == 1 &&
+                  rb[0].x == x0 && rb[0].y == y0 && rb[0].w == x1 - x0 + 1 && rb[0].h == y1 - y0 + 1 &&
+                  dd && dd[mid_y * w + x0] == EdgeDir0 && dd[mid_y * w + x1] == EdgeDir0;
+        failures += SIM_CHECK(ok, "ROI + 1/%u: one closed outline at %dx%d, directions aligned with the output",
+                              ds, w, h);
+
+        roi_cfg.enable_blob_detection = false;
+        roi_cfg.edge_direction = false;
+        sampled.configure(roi_cfg);
+        sampled.process(&fb);
+        failures += SIM_CHECK(memcmp(ref.data(), sampled.getOutput(), w * h) == 0,
+                              "ROI + 1/%u: matches a reference on the sampled gray ROI", ds);
+    }
+
+    // 3c. Stages the edge path cannot run are rejected, not skipped.
+    PipelineConfig bad = config;
+    bad.blur_radius = 2;
+    CvPipeline rejected;
+    bool blur_rejected = !rejected.configure(bad);
+    bad.blur_radius = 0;
+    bad.strip_rows = 8;
+    failures += SIM_CHECK(blur_rejected && !rejected.configure(bad),
+                          "edges + blur_radius / strip_rows rejected by configure()");
+
+    // 4. No full gray frame: only three rows of internal scratch are added.
+    PipelineConfig plain_cfg;
+    ArenaSizes plain = CvPipeline::arenaRequirements(plain_cfg);
+    ArenaSizes fused = CvPipeline::arenaRequirements(config);
+    failures += SIM_CHECK(fused.psram == plain.psram && fused.internal - plain.internal < 8u * plain_cfg.max_frame_w,
+                          "edge stage adds %zu internal bytes and no PSRAM", fused.internal - plain.internal);
+
+    // 5. Cost versus grayscale + intensity threshold.
+    PipelineConfig th_cfg;
+    th_cfg.enable_threshold = true;
+    CvPipeline intensity;
+    intensity.configure(th_cfg);
+    config.enable_blob_detection = false;
+    CvPipeline sobel;
+    sobel.configure(config);
+    const int kRuns = 20;
+    int64_t t_th = 0, t_sobel = 0;
+    for (int i = 0; i < kRuns; i++) {
+        intensity.process(&fb);
+        t_th += intensity.getStageTimeUs(PipelineStage::Grayscale) + intensity.getStageTimeUs(PipelineStage::Threshold);
+        sobel.process(&fb);
+        t_sobel += sobel.getStageTimeUs(PipelineStage::Grayscale);
+    }
+    printf("  Gray + threshold %lld us | fused gray + Sobel + edge threshold %lld us\n",
+           (long long)(t_th / kRuns), (long long)(t_sobel / kRuns));
+
+    free(fb.buf);
+    return failures;
+}
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "CaptureReader.hpp"
+#include "CaptureWriter.hpp"
+#include "CvPipeline.hpp"
+#include "MappedFile.hpp"
+#include "QualityGovernor.hpp"
+#include "SimScenarios.hpp"
+
+static const char* kWorkloadPath = "sim_governor.ccap";
+
+static const int kQuietFrames = 50;
+static const int kBusyFrames = 50;
+static const int kFrames = 2 * kQuietFrames + kBusyFrames;
+
+// Quiet: one object crossing the view. Busy: the same plus a cluttered field
+// of parts (many blobs, lots of foreground) in the middle of the sequence.
+static void drawWorkload(camera_fb_t* fb, int frame) {
+    memset(fb->buf, 0, fb->len);
+    fillRect(fb, 20 + frame, 100, 30, 30);
+    if (frame >= kQuietFrames && frame < kQuietFrames + kBusyFrames) {
+        for (int r = 0; r < 5; r++) {
+            for (int c = 0; c < 7; c++) {
+                fillRect(fb, 12 + c * 44 + (frame % 3), 10 + r * 46, 22, 22);
+            }
+        }
+    }
+}
+
+static PipelineConfig governedConfig() {
+    PipelineConfig config;
+    config.enable_threshold = true;
+    config.threshold_val = 100;
+    config.blur_radius = 1;
+    config.morph_op = MorphOp::Open;
+    config.enable_blob_detection = true;
+    config.blob_moments = true;
+    config.min_blob_area = 40;
+    config.max_blobs = 64;
+    return config;
+}
+
+// Deterministic stand-in for the target's frame time: PSRAM traffic at a
+// fixed bandwidth plus per-pixel labeling and per-blob bookkeeping cost, so
+// the check does not depend on the host's speed or load.
+static int64_t modelledUs(const CvPipeline& pipeline) {
+    const MemTraffic& t = pipeline.getMemTraffic();
+    int64_t us = (int64_t)(t.psram_read + t.psram_write) / 40;
+    us += pipeline.getForegroundPixels() / 2;
+    us += (int64_t)pipeline.getBlobs().size() * 150;
+    if (!pipeline.getBlobShapes().empty()) us += pipeline.getForegroundPixels() / 4;
+    return us;
+}
+
+struct GovernedRun {
+    std::vector<FrameQuality> frames;
+    size_t changes = 0;
+};
+
+// Frame-by-frame replay with the governor in the loop.
+static GovernedRun replayGoverned(const CaptureReader& reader, const GovernorConfig& gcfg) {
+    GovernedRun run;
+    CvPipeline pipeline;
+    QualityGovernor governor;
+    pipeline.configure(governedConfig());
+    governor.init(governedConfig(), gcfg);
+
+    CaptureFrame frame;
+    for (size_t i = 0; i < reader.frameCount() && reader.frame(i, frame); i++) {
+        pipeline.process(&frame.fb);
+        FrameQuality q = governor.update(pipeline, modelledUs(pipeline));
+        run.frames.push_back(q);
+        if (q.changed) {
+            if (!pipeline.configure(governor.config())) {
+                governor.restoreLevel(q.level);
+                pipeline.configure(governor.config());
+            }
+            run.changes++;
+        }
+    }
+    return run;
+}
+
+int runGovernorSim() {
+    printf("\n--- CCM Simulation: Adaptive Quality Governor Test ---\n");
+    int failures = 0;
+
+    camera_fb_t fb;
+    makeFrame(&fb, 320, 240);
+
+    // 1. Record the quiet -> busy -> quiet workload.
+    FILE* f = fopen(kWorkloadPath, "wb");
+    FileSink sink(f);
+    capture::CaptureIndexEntry index[kFrames];
+    CaptureWriter writer(sink, index, kFrames);
+    writer.begin();
+    for (int i = 0; i < kFrames; i++) {
+        drawWorkload(&fb, i);
+        writer.writeFrame(&fb, 1000000 + i * 33333);
+    }
+    writer.finish();
+    fclose(f);
+
+    MappedFile mapped;
+    CaptureReader reader;
+    failures += SIM_CHECK(mapped.open(kWorkloadPath) && reader.open(mapped.data(), mapped.size()) &&
+                          reader.frameCount() == (size_t)kFrames, "workload recorded (%zu frames)",
+                          reader.frameCount());
+
+    // 2. Ladder shape.
+    GovernorConfig gcfg;
+    gcfg.budget_us = 30000;
+    QualityGovernor ladder;
+    ladder.init(governedConfig(), gcfg);
+    const PipelineConfig& l1 = ladder.levelConfig(1);
+    const PipelineConfig& l2 = ladder.levelConfig(2);
+    // Every level must also configure inside the base config's arena; with
+    // pyramid_factor set, blur keeps the mode off until level 1 drops it.
+    PipelineConfig pyramid_base = governedConfig();
+    pyramid_base.pyramid_factor = 4;
+    pyramid_base.blur_radius = 2;
+    const PipelineConfig bases[] = {governedConfig(), pyramid_base};
+    bool arena_ok = true;
+    for (const PipelineConfig& base : bases) {
+        QualityGovernor g;
+        g.init(base, gcfg);
+        ArenaSizes base_need = CvPipeline::arenaRequirements(base);
+        PipelineArena arena;
+        arena_ok &= arena.allocate(base_need);
+        CvPipeline p;
+        for (size_t i = 0; i < g.levelCount(); i++) {
+            ArenaSizes need = CvPipeline::arenaRequirements(g.levelConfig(i));
+            arena_ok &= need.internal <= base_need.internal && need.psram <= base_need.psram &&
+                        p.configure(g.levelConfig(i), arena);
+        }
+    }
+    failures += SIM_CHECK(ladder.levelCount() == 6 && l1.blur_radius == 0 && l1.morph_op == MorphOp::None &&
+                          !l1.blob_moments && l2.downsample_factor == 2 && l2.min_blob_area == 10,
+                          "ladder: %u levels (optional stages, 1/2 scale with scaled min area, ROI, ...)",
+                          ladder.levelCount());
+    failures += SIM_CHECK(arena_ok, "no level needs more arena than the base config (also with pyramid_factor)");
+
+    // 3. Modelled cost of each level on a quiet and a busy frame.
+    printf("  Modelled frame time per level (budget %lld us):\n", (long long)gcfg.budget_us);
+    CvPipeline probe;
+    CaptureFrame quiet, busy;
+    reader.frame(0, quiet);
+    reader.frame(kQuietFrames, busy);
+    for (size_t i = 0; i < ladder.levelCount(); i++) {
+        probe.configure(ladder.levelConfig(i));
+        probe.process(&quiet.fb);
+        int64_t q_us = modelledUs(probe);
+        probe.process(&busy.fb);
+        int64_t b_us = modelledUs(probe);
+        printf("    L%zu: ds %u roi %s | quiet %6lld us | busy %6lld us (%zu blobs)\n", i,
+               ladder.levelConfig(i).downsample_factor, ladder.levelConfig(i).enable_roi ? "on " : "off",
+               (long long)q_us, (long long)b_us, probe.getBlobs().size());
+    }
+
+    // 4. Governed replay.
+    GovernedRun run = replayGoverned(reader, gcfg);
+    int late_quiet = 0, late_busy = 0, late_settled = 0;
+    uint8_t max_level = 0;
+    for (int i = 0; i < kFrames; i++) {
+        const FrameQuality& q = run.frames[i];
+        bool late = q.proc_us > gcfg.budget_us;
+        bool in_busy = i >= kQuietFrames && i < kQuietFrames + kBusyFrames;
+        if (!in_busy && late) late_quiet++;
+        if (in_busy && late) late_busy++;
+        if (in_busy && i >= kQuietFrames + 10 && late) late_settled++;
+        max_level = std::max(max_level, q.level);
+    }
+    const FrameQuality& last = run.frames.back();
+    printf("  Replay: %zu level changes, deepest level %u, %d late frames in the busy phase\n",
+           run.changes, max_level, late_busy);
+
+    failures += SIM_CHECK(run.frames[kQuietFrames - 1].level == 0 && late_quiet == 0,
+                          "quiet scene runs at full quality within budget");
+    failures += SIM_CHECK(max_level > 0 && late_settled == 0 && late_busy <= 4,
+                          "busy scene: %d late frames, then on budget at level %u", late_busy,
+                          run.frames[kQuietFrames + kBusyFrames - 1].level);
+    failures += SIM_CHECK(last.level == 0 && last.downsample == 1,
+                          "quality restored after the load drops");
+    failures += SIM_CHECK(run.changes <= 2u * max_level, "no oscillation (%zu level changes)", run.changes);
+
+    // 5. Cost near the budget: single late frames do not trigger a step.
+    CvPipeline pipeline;
+    pipeline.configure(governedConfig());
+    pipeline.process(&quiet.fb);
+    QualityGovernor steady;
+    steady.init(governedConfig(), gcfg);
+    size_t changes = 0;
+    for (int i = 0; i < 300; i++) {
+        int64_t us = (i % 2) ? gcfg.budget_us * 105 / 100 : gcfg.budget_us * 90 / 100;
+        changes += steady.update(pipeline, us).changed;
+    }
+    failures += SIM_CHECK(changes == 0, "alternating late / on-time frames keep the level (%zu changes)",
+                          changes);
+
+    // 6. Full quality never fits, the next level is cheap: step-ups are
+    //    probes with exponential backoff, not a flip every upgrade window.
+    QualityGovernor probing;
+    probing.init(governedConfig(), gcfg);
+    changes = 0;
+    for (int i = 0; i < 1200; i++) {
+        int64_t us = probing.level() == 0 ? gcfg.budget_us * 12 / 10 : gcfg.budget_us * 4 / 10;
+        changes += probing.update(pipeline, us).changed;
+    }
+    const size_t naive = 2 * 1200 / (gcfg.upgrade_frames + gcfg.degrade_frames);
+    failures += SIM_CHECK(changes <= 16 && probing.level() == 1,
+                          "unaffordable level is probed with backoff (%zu changes vs ~%zu without)",
+                          changes, naive);
+
+    // 7. A level the pipeline rejects: the governor goes back to the level
+    //    that configured, and still steps down again on the next overload.
+    QualityGovernor rejected;
+    rejected.init(governedConfig(), gcfg);
+    FrameQuality q;
+    for (int i = 0; i < gcfg.degrade_frames; i++) q = rejected.update(pipeline, gcfg.budget_us * 2);
+    const bool stepped = q.changed && q.next_level == 1;
+    rejected.restoreLevel(q.level);
+    bool restored = rejected.level() == 0 && pipeline.configure(rejected.config());
+    for (int i = 0; i < gcfg.degrade_frames; i++) q = rejected.update(pipeline, gcfg.budget_us * 2);
+    failures += SIM_CHECK(stepped && restored && q.changed && rejected.level() == 1,
+                          "rejected level restores the previous one, later step-downs still work");
+
+    mapped.close();
+    remove(kWorkloadPath);
+    free(fb.buf);
+    return failures;
+}
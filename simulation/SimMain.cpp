@@ -1,10 +1,12 @@
 #include <iostream>
 #include <vector>
 #include <cstring>
+#include <cstdlib>
 #include <inttypes.h> // For PRId64
 #include "CvPipeline.hpp"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "SimScenarios.hpp"
 
 // Helper: Generate a test pattern (White square on black background)
 // Simulates the raw sensor data (QVGA 320x240)
@@ -21,7 +23,7 @@ void generateTestPattern(camera_fb_t* fb, int x, int y, int w, int h) {
     }
 }
 
-int main() {
+int runRoiDownsampleSim() {
     printf("--- CCM Simulation: ROI & Downsample Test ---\n");
 
     // 1. Setup Mock Camera Frame (Native Sensor Resolution: 320x240)
@@ -97,4 +99,36 @@ int main() {
 
     free(fb.buf);
     return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && strcmp(argv[1], "--replay") == 0) {
+        bool realtime = false;
+        int64_t budget_us = 0;
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--realtime") == 0) realtime = true;
+            else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) budget_us = atoll(argv[++i]);
+        }
+        return runReplayFile(argv[2], realtime, budget_us);
+    }
+
+    int failures = 0;
+    failures += runRoiDownsampleSim();
+    failures += runSettingsSim();
+    failures += runHeapFreeSim();
+    failures += runStripSim();
+    failures += runCaptureSim();
+    failures += runMorphologySim();
+    failures += runShapeSim();
+    failures += runBlurSim();
+    failures += runEdgesSim();
+    failures += runColorSim();
+    failures += runMultiRoiSim();
+    failures += runSensorSim();
+    failures += runGovernorSim();
+    failures += runLoggerSim();
+    failures += runPyramidSim();
+
+    printf("\n--- Simulation finished: %d failed check(s) ---\n", failures);
+    return failures == 0 ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include "CvPipeline.hpp"
+#include "SimScenarios.hpp"
+#include "esp_heap_caps.h"
+
+// --- Allocation-counting hook ---
+// Replaces the global operator new so any hidden std:: container growth in
+// the pipeline shows up as a non-zero count.
+static std::atomic<uint32_t> g_new_count(0);
+
+void* operator new(size_t size) {
+    g_new_count++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    g_new_count++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+uint32_t simHeapAllocations() {
+    return g_new_count.load() + sim_heap_caps_alloc_count();
+}
+
+// Verifies the steady-state pipeline never touches the heap and that the
+// fixed-capacity blob list and flood-fill queue behave deterministically.
+int runHeapFreeSim() {
+    printf("\n--- CCM Simulation: Heap-Free Steady State Test ---\n");
+    int failures = 0;
+
+    camera_fb_t fb;
+    makeFrame(&fb, 320, 240);
+
+    PipelineConfig config;
+    config.enable_threshold = true;
+    config.threshold_val = 100;
+    config.enable_blob_detection = true;
+    config.min_blob_area = 4;
+    config.max_blobs = 8;
+
+    // 1. Zero allocations per frame after warm-up, with a caller-owned arena.
+    alignas(4) static uint8_t internal_mem[64 * 1024];
+    alignas(4) static uint8_t psram_mem[320 * 240 + 64];
+    PipelineArena arena;
+    arena.attach(internal_mem, sizeof(internal_mem), psram_mem, sizeof(psram_mem));
+
+    CvPipeline pipeline;
+    failures += SIM_CHECK(pipeline.configure(config, arena), "configure() with external arena");
+
+    for (int warm = 0; warm < 2; warm++) {
+        memset(fb.buf, 0, fb.len);
+        pipeline.process(&fb);
+    }
+
+    uint32_t before = simHeapAllocations();
+    for (int frame = 0; frame < 100; frame++) {
+        memset(fb.buf, 0, fb.len);
+        for (int k = 0; k < 12; k++) {
+            fillRect(&fb, (frame * 3 + k * 25) % 300, (k * 19) % 220, 6 + k, 6 + k, 0xFFFF);
+        }
+        pipeline.process(&fb);
+    }
+    uint32_t allocs = simHeapAllocations() - before;
+    ArenaSizes need = CvPipeline::arenaRequirements(config);
+    printf("  Arena: %zu B internal + %zu B PSRAM | heap allocations over 100 frames: %u\n",
+           need.internal, need.psram, allocs);
+    failures += SIM_CHECK(allocs == 0, "no heap allocations after warm-up");
+
+    // 2. Blob overflow policies.
+    memset(fb.buf, 0, fb.len);
+    for (int k = 0; k < 10; k++) {
+        fillRect(&fb, 10 + k * 30, 100, 4 + k, 4 + k, 0xFFFF); // areas grow left to right
+    }
+
+    config.max_blobs = 4;
+    config.blob_overflow = BlobOverflowPolicy::KeepFirst;
+    pipeline.configure(config, arena);
+    pipeline.process(&fb);
+    bool first_ok = pipeline.getBlobs().size() == 4 && pipeline.getDroppedBlobs() == 6 &&
+                    pipeline.getBlobs()[0].area == 16 && pipeline.getBlobs()[3].area == 49;
+    failures += SIM_CHECK(first_ok, "KeepFirst keeps the first 4 blobs, drops %u",
+                          pipeline.getDroppedBlobs());
+
+    config.blob_overflow = BlobOverflowPolicy::KeepLargest;
+    pipeline.configure(config, arena);
+    pipeline.process(&fb);
+    uint32_t min_area = UINT32_MAX;
+    for (const auto& b : pipeline.getBlobs()) min_area = std::min(min_area, b.area);
+    failures += SIM_CHECK(pipeline.getBlobs().size() == 4 && min_area == 100,
+                          "KeepLargest keeps the 4 largest blobs (smallest kept area=%u)", min_area);
+
+    // 3. A tiny flood-fill queue gives the same answer via pending-pixel rescans.
+    memset(fb.buf, 0, fb.len);
+    fillRect(&fb, 50, 40, 150, 120, 0xFFFF);
+    fillRect(&fb, 90, 80, 20, 20, 0x0000); // hole
+
+    config.max_blobs = 8;
+    config.label_queue_len = 2048;
+    pipeline.configure(config, arena);
+    pipeline.process(&fb);
+    Blob ref = pipeline.getBlobs()[0];
+
+    config.label_queue_len = 8;
+    pipeline.configure(config, arena);
+    pipeline.process(&fb);
+    const Blob& small = pipeline.getBlobs()[0];
+    failures += SIM_CHECK(pipeline.getBlobs().size() == 1 && small.area == ref.area &&
+                          small.cx == ref.cx && small.cy == ref.cy && small.w == ref.w,
+                          "8-entry queue matches 2048-entry queue (area=%u)", small.area);
+
+    // 4. Frames larger than the configured budget are rejected, not reallocated.
+    camera_fb_t big = fb;
+    big.width = 640;
+    big.height = 480;
+    before = simHeapAllocations();
+    pipeline.process(&big);
+    failures += SIM_CHECK(pipeline.getWidth() == 0 && simHeapAllocations() == before,
+                          "oversized frame rejected without allocating");
+
+    free(fb.buf);
+    return failures;
+}
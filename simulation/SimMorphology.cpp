@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "CvPipeline.hpp"
+#include "Morphology.hpp"
+#include "SimScenarios.hpp"
+#include "esp_timer.h"
+
+// Brute-force reference: neutral outside the image, window [x - r, x + k - 1 - r].
+static void referenceMorph(const std::vector<uint8_t>& in, std::vector<uint8_t>& out,
+                           int w, int h, int kw, int kh, bool erode) {
+    int rx = kw / 2, ry = kh / 2;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            bool acc = erode;
+            for (int j = -ry; j < kh - ry; j++) {
+                for (int i = -rx; i < kw - rx; i++) {
+                    int xx = x + i, yy = y + j;
+                    if (xx < 0 || yy < 0 || xx >= w || yy >= h) continue;
+                    bool v = in[yy * w + xx] != 0;
+                    acc = erode ? (acc && v) : (acc || v);
+                }
+            }
+            out[y * w + x] = acc ? 255 : 0;
+        }
+    }
+}
+
+static bool checkKernel(int w, int h, int kw, int kh, bool erode) {
+    std::vector<uint8_t> mask(w * h), ref(w * h), got(w * h);
+    for (auto& m : mask) m = (rand() % 100 < 60) ? 255 : 0;
+    referenceMorph(mask, ref, w, h, kw, kh, erode);
+
+    size_t stride = morph::strideWords(w);
+    std::vector<uint32_t> a(h * stride), b(h * stride);
+    std::vector<uint32_t> vhgw((h + morph::kMaxKernel) * stride), row(3 * stride);
+    morph::BitPlane pa{a.data(), (size_t)w, (size_t)h, stride};
+    morph::BitPlane pb{b.data(), (size_t)w, (size_t)h, stride};
+    morph::Workspace ws{vhgw.data(), row.data()};
+
+    morph::pack(mask.data(), pa);
+    if (erode) morph::erode(pa, pb, kw, kh, ws);
+    else morph::dilate(pa, pb, kw, kh, ws);
+    morph::unpack(pb, got.data());
+    return got == ref;
+}
+
+static void drawNoisyScene(camera_fb_t* fb, int noise_pct) {
+    uint16_t* pixels = (uint16_t*)fb->buf;
+    for (size_t i = 0; i < fb->width * fb->height; i++) {
+        pixels[i] = (rand() % 100 < noise_pct) ? 0xFFFF : 0x0000;
+    }
+    for (int k = 0; k < 6; k++) {
+        int x0 = 20 + k * 50, y0 = 40 + (k % 3) * 60;
+        for (int y = y0; y < y0 + 24; y++) {
+            for (int x = x0; x < x0 + 24; x++) pixels[y * fb->width + x] = 0xFFFF;
+        }
+    }
+}
+
+// Validates the bit-parallel kernels against a brute-force reference and
+// measures how much labeling work an opening saves on a noisy scene.
+int runMorphologySim() {
+    printf("\n--- CCM Simulation: Morphology Test ---\n");
+    int failures = 0;
+    srand(1234);
+
+    // 1. Exactness on an odd width (partial last word) across kernel sizes.
+    int bad = 0, total = 0;
+    const int sizes[] = {1, 2, 3, 4, 5, 8, 15, 31};
+    for (int kw : sizes) {
+        for (int kh : sizes) {
+            for (int erode = 0; erode < 2; erode++) {
+                total++;
+                if (!checkKernel(77, 41, kw, kh, erode)) {
+                    bad++;
+                    printf("  mismatch: %s %dx%d\n", erode ? "erode" : "dilate", kw, kh);
+                }
+            }
+        }
+    }
+    failures += SIM_CHECK(bad == 0, "%d/%d kernels match the brute-force reference", total - bad, total);
+
+    // 2. Labeling time saved on a noisy scene.
+    camera_fb_t fb;
+    fb.width = 320;
+    fb.height = 240;
+    fb.format = PIXFORMAT_RGB565;
+    fb.len = fb.width * fb.height * 2;
+    fb.buf = (uint8_t*)malloc(fb.len);
+    drawNoisyScene(&fb, 8);
+
+    PipelineConfig config;
+    config.enable_threshold = true;
+    config.threshold_val = 100;
+    config.enable_blob_detection = true;
+    config.min_blob_area = 20;
+    config.max_blobs = 64;
+
+    CvPipeline plain;
+    plain.configure(config);
+    config.morph_op = MorphOp::Open;
+    CvPipeline opened;
+    opened.configure(config);
+
+    const int kRuns = 20;
+    int64_t plain_label = 0, open_label = 0, open_morph = 0;
+    for (int i = 0; i < kRuns; i++) {
+        plain.process(&fb);
+        plain_label += plain.getStageTimeUs(PipelineStage::Blobs);
+        opened.process(&fb);
+        open_label += opened.getStageTimeUs(PipelineStage::Blobs);
+        open_morph += opened.getStageTimeUs(PipelineStage::Morphology);
+    }
+    printf("  No morphology: labeling %5lld us | blobs %zu\n",
+           (long long)(plain_label / kRuns), plain.getBlobs().size());
+    printf("  Open 3x3:      labeling %5lld us + morphology %lld us | blobs %zu\n",
+           (long long)(open_label / kRuns), (long long)(open_morph / kRuns), opened.getBlobs().size());
+    failures += SIM_CHECK(opened.getBlobs().size() == 6, "opening leaves exactly the 6 real objects");
+    failures += SIM_CHECK(open_label < plain_label, "labeling is cheaper after opening");
+
+    // 3. Cost versus kernel size (vHGW keeps the vertical pass flat).
+    printf("  %-8s %12s\n", "Kernel", "Open (us)");
+    for (int k : {3, 7, 15, 31}) {
+        config.morph_kernel_w = (uint8_t)k;
+        config.morph_kernel_h = (uint8_t)k;
+        CvPipeline p;
+        p.configure(config);
+        int64_t t = 0;
+        for (int i = 0; i < kRuns; i++) {
+            p.process(&fb);
+            t += p.getStageTimeUs(PipelineStage::Morphology);
+        }
+        printf("  %2dx%-5d %12lld\n", k, k, (long long)(t / kRuns));
+    }
+
+    free(fb.buf);
+    return failures;
+}
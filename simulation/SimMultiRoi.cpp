@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "CvPipeline.hpp"
+#include "SimScenarios.hpp"
+
+// Watches three zones (two bins and a doorway) with their own thresholds
+// and minimum areas in one pass, and checks the results against running a
+// single-ROI pipeline per zone.
+int runMultiRoiSim() {
+    printf("\n--- CCM Simulation: Multi-ROI Test ---\n");
+    int failures = 0;
+
+    camera_fb_t fb;
+    makeFrame(&fb, 320, 240);
+    fillRect(&fb, 0, 0, 320, 240, grayToRgb565(40));
+    fillRect(&fb, 30, 30, 20, 20, grayToRgb565(220));    // bin A: bright part
+    fillRect(&fb, 70, 50, 20, 20, grayToRgb565(120));    // bin A: dim part (below A's threshold)
+    fillRect(&fb, 220, 140, 30, 24, grayToRgb565(120));  // bin B: dim part (above B's threshold)
+    fillRect(&fb, 280, 200, 2, 2, grayToRgb565(220));    // bin B: speck (below B's min area)
+    fillRect(&fb, 150, 20, 16, 60, grayToRgb565(200));   // doorway: person
+    fillRect(&fb, 5, 200, 40, 20, grayToRgb565(250));    // outside every ROI
+
+    PipelineConfig config;
+    config.enable_threshold = true;
+    config.enable_blob_detection = true;
+    config.downsample_factor = 2;
+    config.roi_count = 3;
+    config.rois[0] = {10, 10, 100, 80, 150, 20};     // bin A
+    config.rois[1] = {200, 120, 100, 100, 80, 20};   // bin B
+    config.rois[2] = {100, 0, 80, 100, 150, 20};     // doorway, overlaps bin A
+
+    CvPipeline multi;
+    failures += SIM_CHECK(multi.configure(config), "three ROIs fit the arena");
+    multi.process(&fb);
+
+    const FixedVector<Blob>& a = multi.getRoiBlobs(0);
+    const FixedVector<Blob>& b = multi.getRoiBlobs(1);
+    const FixedVector<Blob>& d = multi.getRoiBlobs(2);
+    failures += SIM_CHECK(a.size() == 1 && b.size() == 1 && d.size() == 1,
+                          "one blob per zone (A %zu, B %zu, door %zu)", a.size(), b.size(), d.size());
+
+    if (a.size() == 1 && b.size() == 1 && d.size() == 1) {
+        // ROI space is downsampled and relative to the zone; sensor space is the full frame.
+        Blob sa = multi.roiBlobToSensor(0, a[0]);
+        Blob sb = multi.roiBlobToSensor(1, b[0]);
+        failures += SIM_CHECK(a[0].x == 10 && a[0].y == 10 && a[0].w == 10, "bin A blob in ROI coordinates");
+        failures += SIM_CHECK(sa.x == 30 && sa.y == 30 && sa.w == 20 && sa.h == 20, "bin A blob in sensor coordinates");
+        failures += SIM_CHECK(sb.x == 220 && sb.y == 140 && sb.w == 30 && sb.h == 24, "bin B blob in sensor coordinates");
+    }
+
+    // Same output as a single-ROI pipeline per zone.
+    bool same = true;
+    MemTraffic separate;
+    for (size_t i = 0; i < 3; i++) {
+        PipelineConfig single = config;
+        single.roi_count = 0;
+        single.enable_roi = true;
+        single.roi_x = config.rois[i].x;
+        single.roi_y = config.rois[i].y;
+        single.roi_w = config.rois[i].w;
+        single.roi_h = config.rois[i].h;
+        single.threshold_val = config.rois[i].threshold_val;
+        single.min_blob_area = config.rois[i].min_blob_area;
+        single.strip_rows = 16;   // fairest single-ROI baseline: only the ROI rows are read
+        CvPipeline p;
+        p.configure(single);
+        p.process(&fb);
+        same &= p.getWidth() == multi.getRoiWidth(i) && p.getHeight() == multi.getRoiHeight(i) &&
+                memcmp(p.getOutput(), multi.getRoiOutput(i), p.getWidth() * p.getHeight()) == 0 &&
+                p.getBlobs().size() == multi.getRoiBlobs(i).size();
+        separate.psram_read += p.getMemTraffic().psram_read;
+    }
+    failures += SIM_CHECK(same, "each ROI matches a dedicated single-ROI run");
+
+    const MemTraffic& t = multi.getMemTraffic();
+    printf("  Framebuffer + buffer reads: one pass %zu bytes | 3 separate runs %zu bytes | full frame %zu bytes\n",
+           t.psram_read, separate.psram_read, fb.len);
+    failures += SIM_CHECK(t.psram_read < separate.psram_read, "overlapping pixels are read once per frame");
+
+    // Stages that do not run per zone are rejected, and the previous configuration stays active.
+    const size_t roi_w = multi.getRoiWidth(0);
+    bool rejected = true;
+    for (int k = 0; k < 8; k++) {
+        PipelineConfig bad = config;
+        if (k == 0) bad.blob_moments = true;
+        if (k == 1) bad.morph_op = MorphOp::Open;
+        if (k == 2) bad.blur_radius = 1;
+        if (k == 3) bad.strip_rows = 8;
+        if (k == 4) bad.roi_count = kMaxRois + 1;
+        if (k == 5) bad.enable_roi = true;
+        if (k == 6) bad.rois[1].w = 2000;           // zone larger than the max frame
+        if (k == 7) bad.rois[2].h = 1;              // empty after 1/2 downsampling
+        rejected &= !multi.configure(bad);
+    }
+    multi.process(&fb);
+    failures += SIM_CHECK(rejected && multi.getRoiCount() == 3 && multi.getRoiWidth(0) == roi_w &&
+                          multi.getRoiBlobs(0).size() == 1,
+                          "unsupported stages, too many / oversized / empty zones and enable_roi rejected, "
+                          "previous config kept");
+
+    // Zone buffers replace the full-frame output buffer.
+    const ArenaSizes need = CvPipeline::arenaRequirements(config);
+    size_t zones = 0;
+    for (size_t i = 0; i < config.roi_count; i++) {
+        zones += (size_t)(config.rois[i].w / 2) * (config.rois[i].h / 2) + 4;
+    }
+    failures += SIM_CHECK(need.psram == zones && multi.getOutput() == nullptr,
+                          "PSRAM arena holds only the zone buffers (%zu bytes)", need.psram);
+
+    free(fb.buf);
+    return failures;
+}
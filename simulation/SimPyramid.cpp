@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "CvPipeline.hpp"
+#include "esp_timer.h"
+#include "SimScenarios.hpp"
+
+static void fillDisc(camera_fb_t* fb, int cx, int cy, int r, int hole = 0) {
+    for (int j = -r; j <= r; j++) {
+        for (int i = -r; i <= r; i++) {
+            int d = i * i + j * j;
+            if (d <= r * r && d >= hole * hole) setPixel(fb, cx + i, cy + j);
+        }
+    }
+}
+
+// A sparse SVGA scene: parts of different shapes, two parts almost touching,
+// thin protrusions between sample points, a part cut by the frame edge and
+// sensor speckle that only the full-resolution pass can reject.
+static void drawScene(camera_fb_t* fb) {
+    memset(fb->buf, 0, fb->len);
+    fillRect(fb, 40, 50, 60, 40);
+    fillDisc(fb, 300, 120, 25);
+    fillDisc(fb, 520, 140, 40, 18);              // ring (hole)
+    fillRect(fb, 100, 300, 30, 30);               // L-shape with a 1 px arm
+    fillRect(fb, 130, 312, 57, 1);
+    fillRect(fb, 186, 300, 1, 40);
+    fillRect(fb, 400, 350, 50, 20);               // two parts 2 px apart
+    fillRect(fb, 452, 350, 20, 50);
+    fillRect(fb, 620, 380, 12, 60);               // U-shape
+    fillRect(fb, 632, 428, 40, 12);
+    fillRect(fb, 672, 380, 12, 60);
+    fillRect(fb, 770, 560, 60, 60);               // cut by the frame corner
+    fillRect(fb, 250, 480, 9, 9);                 // just above the minimum size
+
+    uint32_t seed = 12345;
+    for (int i = 0; i < 400; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int x = (seed >> 8) % fb->width;
+        seed = seed * 1103515245u + 12345u;
+        int y = (seed >> 8) % fb->height;
+        setPixel(fb, x, y);
+    }
+}
+
+static PipelineConfig pyramidConfig(uint8_t factor) {
+    PipelineConfig config;
+    config.enable_threshold = true;
+    config.threshold_val = 100;
+    config.enable_blob_detection = true;
+    config.min_blob_area = 64;
+    config.max_blobs = 32;
+    config.max_frame_w = 800;
+    config.max_frame_h = 600;
+    config.pyramid_factor = factor;
+    return config;
+}
+
+static bool sameBlobs(const CvPipeline& a, const CvPipeline& b) {
+    const auto& x = a.getBlobs();
+    const auto& y = b.getBlobs();
+    if (x.size() != y.size()) return false;
+    for (size_t i = 0; i < x.size(); i++) {
+        if (x[i].x != y[i].x || x[i].y != y[i].y || x[i].w != y[i].w || x[i].h != y[i].h ||
+            x[i].cx != y[i].cx || x[i].cy != y[i].cy || x[i].area != y[i].area) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool near(float a, float b) {
+    return std::fabs(a - b) <= 1e-3f * std::max(1.0f, std::fabs(a));
+}
+
+static size_t traffic(const CvPipeline& p) {
+    return p.getMemTraffic().psram_read + p.getMemTraffic().psram_write;
+}
+
+int runPyramidSim() {
+    printf("\n--- CCM Simulation: Coarse-to-Fine Pyramid Test ---\n");
+    int failures = 0;
+
+    camera_fb_t fb;
+    makeFrame(&fb, 800, 600);
+    drawScene(&fb);
+
+    CvPipeline full;
+    full.configure(pyramidConfig(0));
+    full.process(&fb);
+    int64_t full_us = 0;
+    for (int i = 0; i < 5; i++) {
+        int64_t t0 = esp_timer_get_time();
+        full.process(&fb);
+        full_us += esp_timer_get_time() - t0;
+    }
+    printf("  Full resolution: %zu blobs | %zu KiB PSRAM traffic | %lld us\n", full.getBlobs().size(),
+           traffic(full) / 1024, (long long)(full_us / 5));
+
+    // 1. Same blob list at 1/4 and 1/8, at a fraction of the pixel work.
+    const uint8_t factors[] = {4, 8};
+    for (uint8_t f : factors) {
+        CvPipeline pyr;
+        pyr.configure(pyramidConfig(f));
+        pyr.process(&fb);
+        int64_t pyr_us = 0;
+        for (int i = 0; i < 5; i++) {
+            int64_t t0 = esp_timer_get_time();
+            pyr.process(&fb);
+            pyr_us += esp_timer_get_time() - t0;
+        }
+        printf("  Pyramid 1/%u:     %zu blobs | %zu KiB PSRAM traffic | %lld us | level %zux%zu, %zu windows\n",
+               f, pyr.getBlobs().size(), traffic(pyr) / 1024, (long long)(pyr_us / 5),
+               pyr.getPyramidWidth(), pyr.getPyramidHeight(), pyr.getPyramidWindowCount());
+        failures += SIM_CHECK(sameBlobs(full, pyr) && pyr.getWidth() == 800 && pyr.getHeight() == 600,
+                              "1/%u: blob list identical to the full-resolution pass", f);
+        failures += SIM_CHECK(traffic(pyr) * 3 < traffic(full), "1/%u: %.0f%% of the full pass's PSRAM traffic",
+                              f, 100.0 * traffic(pyr) / traffic(full));
+    }
+
+    // 2. Shape descriptors follow the blobs into window coordinates.
+    PipelineConfig shaped = pyramidConfig(0);
+    shaped.blob_moments = true;
+    shaped.blob_perimeter = true;
+    full.configure(shaped);
+    full.process(&fb);
+    shaped.pyramid_factor = 8;
+    CvPipeline pyr;
+    pyr.configure(shaped);
+    pyr.process(&fb);
+    bool shapes_ok = sameBlobs(full, pyr) && pyr.getBlobShapes().size() == full.getBlobShapes().size();
+    for (size_t i = 0; shapes_ok && i < pyr.getBlobShapes().size(); i++) {
+        const BlobShape& a = full.getBlobShapes()[i];
+        const BlobShape& b = pyr.getBlobShapes()[i];
+        // Central moments rather than orientation: a square's axis is undefined
+        shapes_ok = near(a.cx, b.cx) && near(a.cy, b.cy) && near(a.mu20, b.mu20) &&
+                    near(a.mu02, b.mu02) && near(a.mu11, b.mu11) && a.perimeter == b.perimeter;
+    }
+    failures += SIM_CHECK(shapes_ok, "moments and perimeters match the full-resolution pass");
+
+    // 3. ROI and downsampling define the fine level the same way as the normal path.
+    PipelineConfig cropped = pyramidConfig(0);
+    cropped.enable_roi = true;
+    cropped.roi_x = 20;
+    cropped.roi_y = 40;
+    cropped.roi_w = 700;
+    cropped.roi_h = 520;
+    cropped.downsample_factor = 2;
+    cropped.min_blob_area = 16;
+    full.configure(cropped);
+    full.process(&fb);
+    cropped.pyramid_factor = 4;
+    pyr.configure(cropped);
+    pyr.process(&fb);
+    failures += SIM_CHECK(sameBlobs(full, pyr) && pyr.getWidth() == full.getWidth() &&
+                          pyr.getHeight() == full.getHeight(),
+                          "ROI + 1/2 downsample: %zu blobs identical at %zux%zu", pyr.getBlobs().size(),
+                          pyr.getWidth(), pyr.getHeight());
+
+    // 4. More candidates than the list holds: falls back to one full window.
+    PipelineConfig small = pyramidConfig(0);
+    small.max_blobs = 2;
+    full.configure(small);
+    full.process(&fb);
+    small.pyramid_factor = 8;
+    pyr.configure(small);
+    pyr.process(&fb);
+    failures += SIM_CHECK(sameBlobs(full, pyr) && pyr.getPyramidWindowCount() == 1,
+                          "candidate overflow falls back to a single full window");
+
+    // 5. Blur or morphology run the full-resolution path instead of being skipped.
+    PipelineConfig blurred = pyramidConfig(0);
+    blurred.blur_radius = 1;
+    full.configure(blurred);
+    full.process(&fb);
+    blurred.pyramid_factor = 8;
+    pyr.configure(blurred);
+    pyr.process(&fb);
+    failures += SIM_CHECK(sameBlobs(full, pyr) && pyr.getPyramidWindowCount() == 0,
+                          "blur disables pyramid mode, blob list matches the blurred full pass");
+
+    // 6. Unsupported factors are rejected and the previous configuration is kept.
+    bool rejected = true;
+    const uint8_t bad[] = {1, 2, 3, 16};
+    for (uint8_t f : bad) rejected &= !pyr.configure(pyramidConfig(f));
+    pyr.process(&fb);
+    failures += SIM_CHECK(rejected && sameBlobs(full, pyr), "pyramid_factor 1, 2, 3 and 16 rejected");
+
+    // 7. Stages pyramid mode cannot run are rejected rather than skipped.
+    PipelineConfig unsupported[5];
+    for (PipelineConfig& c : unsupported) c = pyramidConfig(4);
+    unsupported[0].strip_rows = 16;
+    unsupported[1].enable_color = true;
+    unsupported[2].enable_edges = true;
+    unsupported[3].roi_count = 1;
+    unsupported[3].rois[0] = {0, 0, 400, 300, 100, 64};
+    unsupported[4].enable_threshold = false;
+    rejected = true;
+    for (const PipelineConfig& c : unsupported) rejected &= !pyr.configure(c);
+    failures += SIM_CHECK(rejected, "strips, colour, edges, multi-ROI and a missing threshold are rejected");
+
+    free(fb.buf);
+    return failures;
+}
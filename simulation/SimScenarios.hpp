@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include "esp_camera.h"
+
+// Host simulation scenarios. Each returns the number of failed checks.
+
+int runRoiDownsampleSim();
+int runSettingsSim();
+int runHeapFreeSim();
+int runStripSim();
+int runCaptureSim();
+int runMorphologySim();
+int runShapeSim();
+int runBlurSim();
+int runEdgesSim();
+int runColorSim();
+int runMultiRoiSim();
+int runSensorSim();
+int runGovernorSim();
+int runLoggerSim();
+int runPyramidSim();
+
+// Replay a recorded .ccap file through the pipeline (command-line mode).
+// A non-zero budget_us lets a QualityGovernor adapt the configuration.
+int runReplayFile(const char* path, bool realtime, int64_t budget_us);
+
+// Report a check result in the simulator's log style.
+#define SIM_CHECK(cond, ...) ([&]() {                   \
+        bool ok_ = (cond);                              \
+        printf("  [%s] ", ok_ ? "PASS" : "FAIL");       \
+        printf(__VA_ARGS__);                            \
+        printf("\n");                                   \
+        return ok_ ? 0 : 1;                             \
+    }())
+
+// Synthetic frame helpers shared by the scenarios. Frames are RGB565 and
+// start black; drawing is clipped to the frame.
+inline uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) {
+    return (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+inline uint16_t grayToRgb565(uint8_t g) {
+    return rgb565(g, g, g);
+}
+
+inline void makeFrame(camera_fb_t* fb, size_t w, size_t h) {
+    fb->width = w;
+    fb->height = h;
+    fb->format = PIXFORMAT_RGB565;
+    fb->len = w * h * 2;
+    fb->buf = (uint8_t*)calloc(1, fb->len);
+}
+
+inline void setPixel(camera_fb_t* fb, int x, int y, uint16_t color = 0xFFFF) {
+    if (x >= 0 && x < (int)fb->width && y >= 0 && y < (int)fb->height) {
+        ((uint16_t*)fb->buf)[y * fb->width + x] = color;
+    }
+}
+
+inline void fillRect(camera_fb_t* fb, int x, int y, int w, int h, uint16_t color = 0xFFFF) {
+    for (int j = y; j < y + h; j++) {
+        for (int i = x; i < x + w; i++) setPixel(fb, i, j, color);
+    }
+}
@@ -0,0 +1,209 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "CvPipeline.hpp"
+#include "SensorConfig.hpp"
+#include "SimScenarios.hpp"
+
+// Mock sensor: renders a scene defined in base-frame (QVGA) coordinates
+// through whatever frame size or raw window the driver last programmed.
+struct MockSensor {
+    sensor_t s;               // must be first: callbacks receive &s
+    uint16_t mode_w, mode_h;  // readout resolution
+    bool raw = false;         // set_res_raw() active
+    int win_x = 0, win_y = 0, win_w = 0, win_h = 0, out_w = 0, out_h = 0;
+    bool reject_raw = false;
+    int raw_calls = 0;
+};
+
+static int mockSetFramesize(sensor_t* sensor, framesize_t fs) {
+    MockSensor* m = (MockSensor*)sensor;
+    if (fs >= FRAMESIZE_INVALID) return -1;
+    m->s.status.framesize = fs;
+    m->raw = false;
+    return 0;
+}
+
+static int mockSetResRaw(sensor_t* sensor, int, int, int, int, int offsetX, int offsetY,
+                         int totalX, int totalY, int outputX, int outputY, bool, bool) {
+    MockSensor* m = (MockSensor*)sensor;
+    m->raw_calls++;
+    if (m->reject_raw) return -1;
+    if (offsetX + totalX > m->mode_w || offsetY + totalY > m->mode_h) return -1;
+    if (outputX > totalX || outputY > totalY || outputX % 4 || outputY % 4) return -1;
+    m->raw = true;
+    m->win_x = offsetX; m->win_y = offsetY; m->win_w = totalX; m->win_h = totalY;
+    m->out_w = outputX; m->out_h = outputY;
+    return 0;
+}
+
+static void initMock(MockSensor& m, uint16_t pid, uint16_t mode_w, uint16_t mode_h, bool has_raw) {
+    m = MockSensor();
+    m.s.id.PID = pid;
+    m.s.status.framesize = FRAMESIZE_QVGA;
+    m.s.pixformat = PIXFORMAT_RGB565;
+    m.s.set_framesize = mockSetFramesize;
+    m.s.set_res_raw = has_raw ? mockSetResRaw : nullptr;
+    m.mode_w = mode_w;
+    m.mode_h = mode_h;
+}
+
+// Scene in QVGA coordinates: two bright parts on a dark background.
+static bool sceneAt(float x, float y) {
+    return (x >= 101 && x < 141 && y >= 81 && y < 111) ||
+           (x >= 181 && x < 221 && y >= 131 && y < 161);
+}
+
+static std::vector<uint8_t> s_frame;
+
+// Capture one RGB565 frame as the mock sensor would deliver it.
+static camera_fb_t mockCapture(const MockSensor& m) {
+    const float base_w = 320, base_h = 240;
+    // Base frame = largest 4:3 window of the readout, centred (driver behaviour)
+    float bw = m.mode_w, bh = m.mode_h;
+    if (m.mode_w * base_h > m.mode_h * base_w) bw = m.mode_h * base_w / base_h;
+    else bh = m.mode_w * base_h / base_w;
+    float bx = (m.mode_w - bw) / 2, by = (m.mode_h - bh) / 2;
+
+    camera_fb_t fb;
+    fb.format = PIXFORMAT_RGB565;
+    fb.width = m.raw ? m.out_w : resolution[m.s.status.framesize].width;
+    fb.height = m.raw ? m.out_h : resolution[m.s.status.framesize].height;
+    fb.len = fb.width * fb.height * 2;
+    s_frame.assign(fb.len, 0);
+    fb.buf = s_frame.data();
+
+    uint16_t* px = (uint16_t*)fb.buf;
+    for (size_t y = 0; y < fb.height; y++) {
+        for (size_t x = 0; x < fb.width; x++) {
+            float sx, sy;   // base-frame coordinates of the pixel centre
+            if (m.raw) {
+                float rx = m.win_x + (x + 0.5f) * m.win_w / m.out_w;
+                float ry = m.win_y + (y + 0.5f) * m.win_h / m.out_h;
+                sx = (rx - bx) * base_w / bw;
+                sy = (ry - by) * base_h / bh;
+            } else {
+                sx = (x + 0.5f) * base_w / fb.width;
+                sy = (y + 0.5f) * base_h / fb.height;
+            }
+            px[y * fb.width + x] = sceneAt(sx, sy) ? 0xFFFF : 0x0000;
+        }
+    }
+    return fb;
+}
+
+// Software reference: full QVGA frame through the unmodified configuration.
+static void softwareBlobs(const PipelineConfig& config, std::vector<Blob>& out) {
+    MockSensor full;
+    initMock(full, GC0308_PID, 640, 480, false);
+    camera_fb_t fb = mockCapture(full);
+    CvPipeline p;
+    p.configure(config);
+    p.process(&fb);
+    out.assign(p.getBlobs().begin(), p.getBlobs().end());
+}
+
+static bool sameBlobs(const std::vector<Blob>& a, const FixedVector<Blob>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::abs(a[i].x - b[i].x) > 1 || std::abs(a[i].y - b[i].y) > 1 ||
+            std::abs(a[i].w - b[i].w) > 1 || std::abs(a[i].h - b[i].h) > 1) return false;
+    }
+    return true;
+}
+
+// Runs @p config through SensorConfig on @p mock and compares with software.
+static bool runOffload(MockSensor& mock, const PipelineConfig& config, SensorPlan& plan, size_t& bytes) {
+    SensorConfig sensor;
+    sensor.init(&mock.s, FRAMESIZE_QVGA);
+    if (sensor.apply(config, &plan) != ESP_OK) return false;
+
+    camera_fb_t fb = mockCapture(mock);
+    bytes = fb.len;
+    CvPipeline p;
+    p.configure(plan.pipeline);
+    p.process(&fb);
+
+    std::vector<Blob> ref;
+    softwareBlobs(config, ref);
+    printf("    frame %zux%zu, %6zu bytes, blobs %zu (software %zu)\n",
+           fb.width, fb.height, bytes, p.getBlobs().size(), ref.size());
+    return fb.width == plan.frame_w && fb.height == plan.frame_h && sameBlobs(ref, p.getBlobs());
+}
+
+// Checks the sensor offload choices and that blob coordinates do not
+// depend on whether the sensor or the pipeline did the cropping/scaling.
+int runSensorSim() {
+    printf("\n--- CCM Simulation: Sensor Windowing Test ---\n");
+    int failures = 0;
+    const size_t full_bytes = 320 * 240 * 2;
+
+    PipelineConfig config;
+    config.enable_threshold = true;
+    config.enable_blob_detection = true;
+    config.min_blob_area = 20;
+    config.enable_roi = true;
+    config.roi_x = 80;
+    config.roi_y = 60;
+    config.roi_w = 160;
+    config.roi_h = 120;
+    config.downsample_factor = 2;
+
+    MockSensor mock;
+    SensorPlan plan;
+    size_t bytes = 0;
+
+    // 1. Windowing sensor: ROI and scaling both in the sensor.
+    initMock(mock, OV2640_PID, 400, 296, true);
+    bool ok = runOffload(mock, config, plan, bytes);
+    failures += SIM_CHECK(ok && plan.offload == SensorOffload::WindowScale,
+                          "OV2640: window + scaler, blobs match software path");
+    failures += SIM_CHECK(bytes * 16 == full_bytes, "bytes/frame cut to 1/16 (%zu of %zu)", bytes, full_bytes);
+
+    // 2. Sensor rejects the raw window: falls back to frame-size scaling.
+    initMock(mock, OV2640_PID, 400, 296, true);
+    mock.reject_raw = true;
+    ok = runOffload(mock, config, plan, bytes);
+    failures += SIM_CHECK(ok && plan.offload == SensorOffload::Scale && mock.raw_calls == 1,
+                          "rejected window falls back to QQVGA scaling");
+
+    // 3. No windowing support: frame-size scaling, ROI rescaled in software.
+    initMock(mock, GC0308_PID, 640, 480, false);
+    ok = runOffload(mock, config, plan, bytes);
+    failures += SIM_CHECK(ok && plan.offload == SensorOffload::Scale && plan.pipeline.roi_x == 40 &&
+                          bytes * 4 == full_bytes, "GC0308: QQVGA frames, ROI in software");
+
+    // 4. ROI off the sampling grid: everything stays in software.
+    config.roi_x = 81;
+    initMock(mock, GC0308_PID, 640, 480, false);
+    ok = runOffload(mock, config, plan, bytes);
+    failures += SIM_CHECK(ok && plan.offload == SensorOffload::None && bytes == full_bytes,
+                          "odd ROI origin keeps full frames and software stages");
+
+    // 5. Scaler output not a multiple of 4: no window, still scaled.
+    config.roi_x = 80;
+    config.roi_w = 162;
+    initMock(mock, OV2640_PID, 400, 296, true);
+    ok = runOffload(mock, config, plan, bytes);
+    failures += SIM_CHECK(ok && plan.offload == SensorOffload::Scale && mock.raw_calls == 0,
+                          "unaligned output size skips the window");
+
+    // 6. Multi-ROI is never offloaded.
+    PipelineConfig multi = config;
+    multi.roi_count = 1;
+    multi.rois[0] = {80, 60, 160, 120, 100, 20};
+    SensorConfig sensor;
+    sensor.init(&mock.s, FRAMESIZE_QVGA);
+    failures += SIM_CHECK(sensor.plan(multi).offload == SensorOffload::None, "multi-ROI stays in software");
+
+    // 7. Sensor left in JPEG: the window plan's RGB565 sizes do not apply.
+    config.roi_w = 160;
+    initMock(mock, OV2640_PID, 400, 296, true);
+    mock.s.pixformat = PIXFORMAT_JPEG;
+    sensor.init(&mock.s, FRAMESIZE_QVGA);
+    failures += SIM_CHECK(!sensor.caps().windowing && sensor.plan(config).offload != SensorOffload::WindowScale,
+                          "non-RGB565 sensor is never windowed");
+
+    return failures;
+}
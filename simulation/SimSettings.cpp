@@ -0,0 +1,177 @@
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <new>
+#include <thread>
+#include <vector>
+#include "Settings.hpp"
+#include "SimScenarios.hpp"
+#include "esp_timer.h"
+#include "nvs.h"
+
+// Exercises the tagged settings record and the coalescing background writer
+// against the file-backed NVS mock.
+int runSettingsSim() {
+    printf("\n--- CCM Simulation: Settings Persistence Test ---\n");
+    int failures = 0;
+
+    nvs_sim_set_path("sim_nvs.bin");
+    remove("sim_nvs.bin");
+
+    // 1. Legacy v0 raw blob is migrated to the tagged record.
+    struct LegacyV0 {
+        bool enable_grayscale, enable_threshold; uint8_t threshold_val; bool invert, enable_roi;
+        uint16_t roi_x, roi_y, roi_w, roi_h; uint8_t downsample_factor;
+        bool enable_blob_detection; uint32_t min_blob_area;
+    } legacy = {true, true, 77, false, true, 10, 20, 100, 50, 2, true, 33};
+
+    nvs_flash_init();
+    nvs_handle_t h;
+    nvs_open("ccm_cfg", NVS_READWRITE, &h);
+    nvs_set_blob(h, "pipe_cfg", &legacy, sizeof(legacy));
+    nvs_commit(h);
+    nvs_close(h);
+
+    Settings& s = Settings::get();
+    s.setDebounce(50, 500);
+    failures += SIM_CHECK(s.init() == ESP_OK, "init() with legacy blob");
+    failures += SIM_CHECK(s.cfg().threshold_val == 77 && s.cfg().roi_w == 100 &&
+                          s.cfg().downsample_factor == 2 && s.cfg().min_blob_area == 33,
+                          "legacy fields migrated (th=%u roi_w=%u ds=%u area=%u)",
+                          s.cfg().threshold_val, s.cfg().roi_w, s.cfg().downsample_factor,
+                          s.cfg().min_blob_area);
+
+    size_t len = 0;
+    nvs_open("ccm_cfg", NVS_READONLY, &h);
+    bool legacy_gone = nvs_get_blob(h, "pipe_cfg", nullptr, &len) == ESP_ERR_NVS_NOT_FOUND;
+    bool record_present = nvs_get_blob(h, "cfg", nullptr, &len) == ESP_OK;
+    nvs_close(h);
+    failures += SIM_CHECK(legacy_gone && record_present, "legacy key erased, tagged record written");
+
+    // 2. Forward compatibility: unknown tags from a newer schema are skipped.
+    uint8_t record[Settings::kMaxRecordSize];
+    PipelineConfig src;
+    src.threshold_val = 201;
+    src.min_blob_area = 4242;
+    size_t n = Settings::encode(src, record, sizeof(record));
+    record[2] = Settings::kSchemaVersion + 1;          // newer schema
+    record[3] += 1;                                    // one extra entry
+    record[n++] = 250; record[n++] = 3;                // unknown tag, 3-byte payload
+    record[n++] = 1; record[n++] = 2; record[n++] = 3;
+    PipelineConfig dst;
+    esp_err_t err = Settings::decode(record, n, dst);
+    failures += SIM_CHECK(err == ESP_OK && dst.threshold_val == 201 && dst.min_blob_area == 4242,
+                          "record from newer schema decodes known fields");
+
+    // 2b. Array elements are stored member by member: the record does not
+    //     depend on struct padding and a changed member loses only itself.
+    alignas(PipelineConfig) uint8_t raw_a[sizeof(PipelineConfig)], raw_b[sizeof(PipelineConfig)];
+    memset(raw_a, 0x00, sizeof(raw_a));
+    memset(raw_b, 0xA5, sizeof(raw_b));
+    PipelineConfig* arr_a = new (raw_a) PipelineConfig;
+    PipelineConfig* arr_b = new (raw_b) PipelineConfig;
+    for (PipelineConfig* c : {arr_a, arr_b}) {
+        c->color_class_count = 2;
+        c->color_classes[1].space = ColorSpace::YUV;
+        c->color_classes[1].min[2] = 140;
+        c->color_classes[1].max[0] = 200;
+        c->roi_count = 2;
+        c->rois[1].x = 640;
+        c->rois[1].threshold_val = 33;
+        c->rois[1].min_blob_area = 70000;
+    }
+    uint8_t rec_a[Settings::kMaxRecordSize], rec_b[Settings::kMaxRecordSize];
+    size_t na = Settings::encode(*arr_a, rec_a, sizeof(rec_a));
+    size_t nb = Settings::encode(*arr_b, rec_b, sizeof(rec_b));
+    PipelineConfig arr_dst;
+    err = Settings::decode(rec_a, na, arr_dst);
+    const ColorClass& cc = arr_dst.color_classes[1];
+    const RoiConfig& rc = arr_dst.rois[1];
+    failures += SIM_CHECK(na > 0 && na == nb && memcmp(rec_a, rec_b, na) == 0 && err == ESP_OK &&
+                          arr_dst.color_class_count == 2 && cc.space == ColorSpace::YUV && cc.min[2] == 140 &&
+                          cc.max[0] == 200 && arr_dst.roi_count == 2 && rc.x == 640 && rc.threshold_val == 33 &&
+                          rc.min_blob_area == 70000,
+                          "colour classes and ROIs round-trip per member (%zu-byte record, padding-free)", na);
+
+    // A member whose width changed (tag 36, colour class min) is skipped alone:
+    // rewrite the record with one extra byte in every tag-36 payload.
+    size_t widened = 0;
+    uint8_t rec_w[Settings::kMaxRecordSize];
+    memcpy(rec_w, rec_a, 4);
+    size_t wpos = 4;
+    for (size_t pos = 4; pos + 2 <= na; pos += 2 + rec_a[pos + 1]) {
+        const uint8_t tag = rec_a[pos], plen = rec_a[pos + 1];
+        rec_w[wpos++] = tag;
+        rec_w[wpos++] = tag == 36 ? plen + 1 : plen;
+        memcpy(rec_w + wpos, rec_a + pos + 2, plen);
+        wpos += plen;
+        if (tag == 36) { rec_w[wpos++] = 0; widened++; }
+    }
+    PipelineConfig wide_dst;
+    err = Settings::decode(rec_w, wpos, wide_dst);
+    failures += SIM_CHECK(widened > 0 && err == ESP_OK && wide_dst.color_classes[1].space == ColorSpace::YUV &&
+                          wide_dst.color_classes[1].max[0] == 200 && wide_dst.color_classes[1].min[2] == 0 &&
+                          wide_dst.rois[1].x == 640,
+                          "a resized member loses only that member, not the whole array");
+
+    // 3. Backward compatibility: a record missing fields keeps defaults.
+    const uint8_t old_record[] = {0x43, 0x43, 1, 1, 3, 1, 42}; // only threshold_val
+    PipelineConfig partial;
+    err = Settings::decode(old_record, sizeof(old_record), partial);
+    failures += SIM_CHECK(err == ESP_OK && partial.threshold_val == 42 &&
+                          partial.min_blob_area == PipelineConfig().min_blob_area,
+                          "older record keeps defaults for missing fields");
+
+    // 4. A burst of saves is coalesced into one commit and never blocks the caller.
+    nvs_sim_set_commit_latency_ms(20);
+    nvs_sim_reset_counters();
+    SettingsStats before = s.stats();
+
+    int64_t worst_call_us = 0;
+    for (int i = 0; i < 25; i++) {
+        s.cfg().threshold_val = (uint8_t)(100 + i);
+        int64_t t0 = esp_timer_get_time();
+        s.save();
+        worst_call_us = std::max(worst_call_us, esp_timer_get_time() - t0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    SettingsStats after = s.stats();
+    printf("  save() calls: %u | NVS commits: %u | worst save() call: %lld us | commit latency: %lld us\n",
+           after.save_requests - before.save_requests, nvs_sim_commit_count(),
+           (long long)worst_call_us, (long long)after.last_commit_us);
+    failures += SIM_CHECK(nvs_sim_commit_count() == 1, "25 saves coalesced into 1 commit");
+    failures += SIM_CHECK(worst_call_us < 20000, "save() does not wait for the flash commit");
+
+    // 5. The committed record reloads with the last value.
+    s.cfg().threshold_val = 0;
+    s.load();
+    failures += SIM_CHECK(s.cfg().threshold_val == 124, "reload returns last saved value (%u)",
+                          s.cfg().threshold_val);
+
+    // 6. A newer firmware's record longer than kMaxRecordSize still loads.
+    std::vector<uint8_t> big(Settings::kMaxRecordSize * 2);
+    PipelineConfig newer;
+    newer.threshold_val = 187;
+    size_t big_len = Settings::encode(newer, big.data(), big.size());
+    for (int k = 0; k < 3; k++) {
+        big[3] += 1;
+        big[big_len++] = (uint8_t)(240 + k);           // unknown tag, 200-byte payload
+        big[big_len++] = 200;
+        big_len += 200;
+    }
+    nvs_open("ccm_cfg", NVS_READWRITE, &h);
+    nvs_set_blob(h, "cfg", big.data(), big_len);
+    nvs_commit(h);
+    nvs_close(h);
+    s.cfg().threshold_val = 0;
+    err = s.load();
+    failures += SIM_CHECK(big_len > Settings::kMaxRecordSize && err == ESP_OK && s.cfg().threshold_val == 187,
+                          "%zu-byte record from newer firmware loads (th=%u)", big_len, s.cfg().threshold_val);
+
+    s.shutdown();
+    nvs_sim_set_commit_latency_ms(0);
+    remove("sim_nvs.bin");
+    return failures;
+}
@@ -0,0 +1,143 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "CvPipeline.hpp"
+#include "SimScenarios.hpp"
+
+// Bar of half-length @p hl and half-width @p hw centred on (cx, cy), rotated by @p angle.
+static void fillBar(camera_fb_t* fb, float cx, float cy, float hl, float hw, float angle) {
+    uint16_t* pixels = (uint16_t*)fb->buf;
+    float c = std::cos(angle), s = std::sin(angle);
+    for (size_t y = 0; y < fb->height; y++) {
+        for (size_t x = 0; x < fb->width; x++) {
+            float dx = x - cx, dy = y - cy;
+            float u = dx * c + dy * s;
+            float v = -dx * s + dy * c;
+            if (std::fabs(u) <= hl && std::fabs(v) <= hw) pixels[y * fb->width + x] = 0xFFFF;
+        }
+    }
+}
+
+static const BlobShape* shapeNear(const CvPipeline& p, int x, int y) {
+    const FixedVector<Blob>& blobs = p.getBlobs();
+    for (size_t i = 0; i < blobs.size(); i++) {
+        if (std::abs(blobs[i].cx - x) <= 1 && std::abs(blobs[i].cy - y) <= 1) {
+            return &p.getBlobShapes()[i];
+        }
+    }
+    return nullptr;
+}
+
+// Checks the optional shape descriptors against analytic values and that
+// the default path neither grows Blob nor pays for them.
+int runShapeSim() {
+    printf("\n--- CCM Simulation: Blob Shape Descriptors Test ---\n");
+    int failures = 0;
+
+    camera_fb_t fb;
+    makeFrame(&fb, 320, 240);
+
+    const float kPi = 3.14159265f;
+    const float kAngle = kPi / 6; // 30 degrees, clockwise on screen (y down)
+    fillRect(&fb, 10, 10, 20, 20);                  // square, centroid (19.5, 19.5)
+    fillBar(&fb, 160, 120, 40, 5, kAngle);          // elongated, rotated bar
+    fillRect(&fb, 250, 30, 8, 40);                  // upright bar
+
+    PipelineConfig config;
+    config.enable_threshold = true;
+    config.threshold_val = 100;
+    config.enable_blob_detection = true;
+    config.min_blob_area = 20;
+
+    // 1. Default path: no descriptors, no extra storage.
+    CvPipeline plain;
+    plain.configure(config);
+    plain.process(&fb);
+    failures += SIM_CHECK(sizeof(Blob) == 20, "Blob stays 20 bytes (no descriptor fields)");
+    failures += SIM_CHECK(plain.getBlobs().size() == 3 && plain.getBlobShapes().capacity() == 0,
+                          "default config reserves no shape storage");
+
+    // 2. Moments and perimeter.
+    config.blob_moments = true;
+    config.blob_perimeter = true;
+    CvPipeline shaped;
+    shaped.configure(config);
+    shaped.process(&fb);
+    failures += SIM_CHECK(shaped.getBlobShapes().size() == shaped.getBlobs().size(),
+                          "one descriptor per blob (%zu)", shaped.getBlobShapes().size());
+
+    const BlobShape* sq = shapeNear(shaped, 19, 19);
+    const BlobShape* bar = shapeNear(shaped, 160, 120);
+    const BlobShape* up = shapeNear(shaped, 253, 49);
+    if (!sq || !bar || !up) {
+        failures += SIM_CHECK(false, "all three test shapes found");
+        free(fb.buf);
+        return failures;
+    }
+
+    printf("  square: c=(%.2f, %.2f) ecc=%.3f perim=%u\n", sq->cx, sq->cy, sq->eccentricity, sq->perimeter);
+    printf("  bar:    c=(%.2f, %.2f) ecc=%.3f theta=%.1f deg\n", bar->cx, bar->cy, bar->eccentricity,
+           bar->orientation * 180 / kPi);
+    printf("  upright: ecc=%.3f theta=%.1f deg perim=%u\n", up->eccentricity,
+           up->orientation * 180 / kPi, up->perimeter);
+
+    failures += SIM_CHECK(std::fabs(sq->cx - 19.5f) < 1e-3f && std::fabs(sq->cy - 19.5f) < 1e-3f,
+                          "sub-pixel centroid of a 20x20 square is (19.5, 19.5)");
+    failures += SIM_CHECK(sq->eccentricity < 0.05f, "square is isotropic");
+    failures += SIM_CHECK(sq->perimeter == 76, "square perimeter is 2W + 2H - 4 boundary pixels");
+    failures += SIM_CHECK(std::fabs(bar->orientation - kAngle) < 0.02f, "rotated bar orientation within 1 degree");
+    failures += SIM_CHECK(bar->eccentricity > 0.95f, "rotated bar is strongly elongated");
+    failures += SIM_CHECK(std::fabs(std::fabs(up->orientation) - kPi / 2) < 1e-3f, "upright bar points along y");
+    failures += SIM_CHECK(up->perimeter == 2 * 8 + 2 * 40 - 4, "upright bar perimeter");
+
+    // 3. Descriptors stay aligned when KeepLargest evicts blobs.
+    config.max_blobs = 2;
+    config.blob_overflow = BlobOverflowPolicy::KeepLargest;
+    CvPipeline capped;
+    capped.configure(config);
+    capped.process(&fb);
+    bool aligned = capped.getBlobShapes().size() == capped.getBlobs().size();
+    for (size_t i = 0; aligned && i < capped.getBlobs().size(); i++) {
+        const Blob& b = capped.getBlobs()[i];
+        aligned = std::fabs(capped.getBlobShapes()[i].cx - b.cx) < 1.0f;
+    }
+    failures += SIM_CHECK(aligned, "descriptors follow blobs under KeepLargest eviction");
+
+    // 4. Cost of the descriptors.
+    const int kRuns = 20;
+    int64_t t_plain = 0, t_shaped = 0;
+    for (int i = 0; i < kRuns; i++) {
+        plain.process(&fb);
+        t_plain += plain.getStageTimeUs(PipelineStage::Blobs);
+        shaped.process(&fb);
+        t_shaped += shaped.getStageTimeUs(PipelineStage::Blobs);
+    }
+    printf("  Labeling: plain %lld us | moments+perimeter %lld us\n",
+           (long long)(t_plain / kRuns), (long long)(t_shaped / kRuns));
+    free(fb.buf);
+
+    // 5. Small blob far from the origin of a UXGA frame: the moments must not
+    //    lose precision to the size of the frame coordinates.
+    makeFrame(&fb, 1600, 1200);
+    fillRect(&fb, 1500, 1190, 2, 3);
+    config = PipelineConfig();
+    config.enable_threshold = true;
+    config.threshold_val = 100;
+    config.enable_blob_detection = true;
+    config.min_blob_area = 1;
+    config.blob_moments = true;
+    config.max_frame_w = 1600;
+    config.max_frame_h = 1200;
+    CvPipeline uxga;
+    uxga.configure(config);
+    uxga.process(&fb);
+    const BlobShape* small = uxga.getBlobShapes().empty() ? nullptr : &uxga.getBlobShapes()[0];
+    failures += SIM_CHECK(small && std::fabs(small->mu20 - 0.25f) < 1e-4f && std::fabs(small->mu02 - 2.0f / 3) < 1e-4f &&
+                          std::fabs(small->mu11) < 1e-4f && std::fabs(small->cy - 1191.0f) < 1e-3f,
+                          "2x3 blob at y=1190 of UXGA: mu20 %.4f, mu02 %.4f (0.25, 0.6667)",
+                          small ? small->mu20 : 0.0f, small ? small->mu02 : 0.0f);
+
+    free(fb.buf);
+    return failures;
+}
@@ -2,11 +2,18 @@
 #include <cstdint>
 #include <cstddef>
 
-// Mock Pixel Formats
+// Mock Pixel Formats (values match esp32-camera's sensor.h so that
+// captures recorded on target replay with the same format ids)
 typedef enum {
-    PIXFORMAT_RGB565,
-    PIXFORMAT_GRAYSCALE,
-    PIXFORMAT_JPEG
+    PIXFORMAT_RGB565,    // 2BPP/RGB565
+    PIXFORMAT_YUV422,    // 2BPP/YUV422
+    PIXFORMAT_YUV420,    // 1.5BPP/YUV420
+    PIXFORMAT_GRAYSCALE, // 1BPP/GRAYSCALE
+    PIXFORMAT_JPEG,      // JPEG/COMPRESSED
+    PIXFORMAT_RGB888,    // 3BPP/RGB888
+    PIXFORMAT_RAW,       // RAW
+    PIXFORMAT_RGB444,    // 3BP2P/RGB444
+    PIXFORMAT_RGB555,    // 3BP2P/RGB555
 } pixformat_t;
 
 // Mock Framebuffer Struct
@@ -16,4 +23,68 @@ typedef struct {
     size_t width;
     size_t height;
     pixformat_t format;
-} camera_fb_t;
\ No newline at end of file
+} camera_fb_t;
+
+// Mock frame sizes (order matches esp32-camera's sensor.h)
+typedef enum {
+    FRAMESIZE_96X96,    // 96x96
+    FRAMESIZE_QQVGA,    // 160x120
+    FRAMESIZE_128X128,  // 128x128
+    FRAMESIZE_QCIF,     // 176x144
+    FRAMESIZE_HQVGA,    // 240x176
+    FRAMESIZE_240X240,  // 240x240
+    FRAMESIZE_QVGA,     // 320x240
+    FRAMESIZE_320X320,  // 320x320
+    FRAMESIZE_CIF,      // 400x296
+    FRAMESIZE_HVGA,     // 480x320
+    FRAMESIZE_VGA,      // 640x480
+    FRAMESIZE_SVGA,     // 800x600
+    FRAMESIZE_XGA,      // 1024x768
+    FRAMESIZE_HD,       // 1280x720
+    FRAMESIZE_SXGA,     // 1280x1024
+    FRAMESIZE_UXGA,     // 1600x1200
+    FRAMESIZE_INVALID
+} framesize_t;
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+} resolution_info_t;
+
+inline const resolution_info_t resolution[FRAMESIZE_INVALID] = {
+    {96, 96}, {160, 120}, {128, 128}, {176, 144}, {240, 176}, {240, 240},
+    {320, 240}, {320, 320}, {400, 296}, {480, 320}, {640, 480}, {800, 600},
+    {1024, 768}, {1280, 720}, {1280, 1024}, {1600, 1200},
+};
+
+// Mock sensor product ids (subset of esp32-camera's camera_pid_t)
+typedef enum {
+    OV7725_PID = 0x77,
+    OV2640_PID = 0x26,
+    OV3660_PID = 0x3660,
+    OV5640_PID = 0x5640,
+    GC0308_PID = 0x9b,
+} camera_pid_t;
+
+typedef struct {
+    uint8_t MIDH;
+    uint8_t MIDL;
+    uint16_t PID;
+    uint8_t VER;
+} sensor_id_t;
+
+typedef struct {
+    framesize_t framesize;
+} camera_status_t;
+
+// Mock sensor handle: only the members the firmware uses.
+typedef struct _sensor sensor_t;
+struct _sensor {
+    sensor_id_t id;
+    camera_status_t status;
+    pixformat_t pixformat;
+    int (*set_framesize)(sensor_t* sensor, framesize_t framesize);
+    int (*set_res_raw)(sensor_t* sensor, int startX, int startY, int endX, int endY,
+                       int offsetX, int offsetY, int totalX, int totalY,
+                       int outputX, int outputY, bool scale, bool binning);
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+// Mock ESP-IDF error codes (values match esp_err.h / nvs.h)
+typedef int esp_err_t;
+
+#define ESP_OK                        0
+#define ESP_FAIL                      -1
+#define ESP_ERR_NO_MEM                0x101
+#define ESP_ERR_INVALID_ARG           0x102
+#define ESP_ERR_INVALID_STATE         0x103
+#define ESP_ERR_INVALID_SIZE          0x104
+#define ESP_ERR_NOT_FOUND             0x105
+#define ESP_ERR_NOT_SUPPORTED         0x106
+#define ESP_ERR_INVALID_VERSION       0x10A
+
+#define ESP_ERR_NVS_BASE              0x1100
+#define ESP_ERR_NVS_NOT_INITIALIZED   (ESP_ERR_NVS_BASE + 0x01)
+#define ESP_ERR_NVS_NOT_FOUND         (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_INVALID_LENGTH    (ESP_ERR_NVS_BASE + 0x0c)
+#define ESP_ERR_NVS_NO_FREE_PAGES     (ESP_ERR_NVS_BASE + 0x0d)
+#define ESP_ERR_NVS_NEW_VERSION_FOUND (ESP_ERR_NVS_BASE + 0x10)
+
+inline const char* esp_err_to_name(esp_err_t err) {
+    switch (err) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_NVS_NO_FREE_PAGES: return "ESP_ERR_NVS_NO_FREE_PAGES";
+        case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+        default: return "UNKNOWN_ERROR";
+    }
+}
+
+#define ESP_ERROR_CHECK(x) do {                                         \
+        esp_err_t err_rc_ = (x);                                        \
+        if (err_rc_ != ESP_OK) {                                        \
+            printf("ESP_ERROR_CHECK failed: %s\n", esp_err_to_name(err_rc_)); \
+            abort();                                                    \
+        }                                                               \
+    } while (0)
@@ -1,14 +1,24 @@
 #pragma once
+#include <cstdint>
 #include <cstdlib>
 
 // Map ESP32-specific memory allocation to standard malloc
 #define MALLOC_CAP_SPIRAM 0
 #define MALLOC_CAP_8BIT 0
+#define MALLOC_CAP_INTERNAL 0
+
+// Simulation hook: number of heap_caps_malloc() calls so far.
+inline uint32_t& sim_heap_caps_alloc_count() {
+    static uint32_t count = 0;
+    return count;
+}
 
 inline void* heap_caps_malloc(size_t size, uint32_t caps) {
+    (void)caps;
+    sim_heap_caps_alloc_count()++;
     return malloc(size);
 }
 
 inline void heap_caps_free(void* ptr) {
     free(ptr);
-}
\ No newline at end of file
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include "esp_err.h"
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Mock NVS: a file-backed key/value store.
+// Values live in memory; nvs_commit() rewrites the backing file, counts the
+// commit and sleeps for a configurable "flash latency" so persistence timing
+// can be tested on the host.
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode_t;
+
+struct NvsSimStore {
+    std::mutex mutex;
+    std::string path = "nvs_sim.bin";
+    std::map<std::string, std::map<std::string, std::vector<uint8_t>>> data;
+    std::map<nvs_handle_t, std::string> handles;
+    nvs_handle_t next_handle = 1;
+    bool initialized = false;
+    uint32_t commit_count = 0;
+    uint32_t commit_latency_ms = 0;
+};
+
+inline NvsSimStore& nvs_sim_store() {
+    static NvsSimStore store;
+    return store;
+}
+
+// --- Simulation hooks ---
+
+inline void nvs_sim_set_path(const char* path) { nvs_sim_store().path = path; }
+inline void nvs_sim_set_commit_latency_ms(uint32_t ms) { nvs_sim_store().commit_latency_ms = ms; }
+inline uint32_t nvs_sim_commit_count() { return nvs_sim_store().commit_count; }
+inline void nvs_sim_reset_counters() { nvs_sim_store().commit_count = 0; }
+
+inline void nvs_sim_load_file_locked(NvsSimStore& s) {
+    s.data.clear();
+    FILE* f = fopen(s.path.c_str(), "rb");
+    if (!f) return;
+
+    auto readStr = [f](std::string& out) {
+        uint32_t len = 0;
+        if (fread(&len, sizeof(len), 1, f) != 1) return false;
+        out.resize(len);
+        return len == 0 || fread(&out[0], 1, len, f) == len;
+    };
+
+    std::string ns, key, blob;
+    while (readStr(ns) && readStr(key) && readStr(blob)) {
+        s.data[ns][key].assign(blob.begin(), blob.end());
+    }
+    fclose(f);
+}
+
+inline void nvs_sim_write_file_locked(const NvsSimStore& s) {
+    FILE* f = fopen(s.path.c_str(), "wb");
+    if (!f) return;
+
+    auto writeBytes = [f](const void* p, uint32_t len) {
+        fwrite(&len, sizeof(len), 1, f);
+        if (len) fwrite(p, 1, len, f);
+    };
+
+    for (const auto& ns : s.data) {
+        for (const auto& kv : ns.second) {
+            writeBytes(ns.first.data(), ns.first.size());
+            writeBytes(kv.first.data(), kv.first.size());
+            writeBytes(kv.second.data(), kv.second.size());
+        }
+    }
+    fclose(f);
+}
+
+// --- nvs_flash.h API ---
+
+inline esp_err_t nvs_flash_init() {
+    NvsSimStore& s = nvs_sim_store();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    nvs_sim_load_file_locked(s);
+    s.initialized = true;
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_flash_erase() {
+    NvsSimStore& s = nvs_sim_store();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.data.clear();
+    remove(s.path.c_str());
+    return ESP_OK;
+}
+
+// --- nvs.h API ---
+
+inline esp_err_t nvs_open(const char* ns, nvs_open_mode_t mode, nvs_handle_t* out) {
+    NvsSimStore& s = nvs_sim_store();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (!s.initialized) return ESP_ERR_NVS_NOT_INITIALIZED;
+    if (mode == NVS_READONLY && s.data.find(ns) == s.data.end()) return ESP_ERR_NVS_NOT_FOUND;
+
+    s.data[ns]; // READWRITE creates the namespace
+    *out = s.next_handle++;
+    s.handles[*out] = ns;
+    return ESP_OK;
+}
+
+inline void nvs_close(nvs_handle_t handle) {
+    NvsSimStore& s = nvs_sim_store();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.handles.erase(handle);
+}
+
+inline esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out, size_t* length) {
+    NvsSimStore& s = nvs_sim_store();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto h = s.handles.find(handle);
+    if (h == s.handles.end()) return ESP_ERR_INVALID_ARG;
+
+    auto& ns = s.data[h->second];
+    auto it = ns.find(key);
+    if (it == ns.end()) return ESP_ERR_NVS_NOT_FOUND;
+
+    if (!out) {
+        *length = it->second.size();
+        return ESP_OK;
+    }
+    if (*length < it->second.size()) return ESP_ERR_NVS_INVALID_LENGTH;
+
+    memcpy(out, it->second.data(), it->second.size());
+    *length = it->second.size();
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    NvsSimStore& s = nvs_sim_store();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto h = s.handles.find(handle);
+    if (h == s.handles.end()) return ESP_ERR_INVALID_ARG;
+
+    const uint8_t* p = static_cast<const uint8_t*>(value);
+    s.data[h->second][key].assign(p, p + length);
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    NvsSimStore& s = nvs_sim_store();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto h = s.handles.find(handle);
+    if (h == s.handles.end()) return ESP_ERR_INVALID_ARG;
+    return s.data[h->second].erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+inline esp_err_t nvs_commit(nvs_handle_t handle) {
+    NvsSimStore& s = nvs_sim_store();
+    uint32_t latency_ms = 0;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.handles.find(handle) == s.handles.end()) return ESP_ERR_INVALID_ARG;
+        nvs_sim_write_file_locked(s);
+        s.commit_count++;
+        latency_ms = s.commit_latency_ms;
+    }
+    // Model the flash erase/program time the calling task would be blocked for.
+    if (latency_ms) std::this_thread::sleep_for(std::chrono::milliseconds(latency_ms));
+    return ESP_OK;
+}
@@ -0,0 +1,3 @@
+#pragma once
+// nvs_flash_init()/nvs_flash_erase() are provided by the file-backed mock in nvs.h
+#include "nvs.h"